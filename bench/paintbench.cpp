@@ -0,0 +1,1018 @@
+// Paint library benchmark: checks the library's drawing routines against straightforward reference
+// versions and times both, printing one JSON object per line like renderbench. Built by `make bench`.
+//
+//   bench/paintbench [--repeats N] [--case NAME]
+//
+// Exits non zero if any library routine leaves a different image than its reference.
+#include "GUI_Paint.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef BENCH_COMMIT
+#define BENCH_COMMIT "unknown"
+#endif
+
+using namespace std;
+using namespace chrono;
+
+static constexpr UWORD Width = 800;
+static constexpr UWORD Height = 480;
+
+static const UWORD Rotations[] = {ROTATE_0, ROTATE_90, ROTATE_180, ROTATE_270};
+static const UBYTE Mirrors[] = {MIRROR_NONE, MIRROR_HORIZONTAL, MIRROR_VERTICAL, MIRROR_ORIGIN};
+static const UBYTE Scales[] = {2, 4, 7, 16};
+
+// The bounds checks let writes one past the right and bottom edges through, so there is a spare row
+static vector<UBYTE> image(Width * (Height + 1));
+static vector<UBYTE> expected(Width * (Height + 1));
+
+// Paint_SetPixel as it was before the pixel writers, working out rotation, mirroring and scale
+// on every call. Not inlined, so it costs a call per pixel like the library function does.
+static __attribute__((noinline)) void ReferenceSetPixel(PAINT* paint, UWORD Xpoint, UWORD Ypoint, UWORD Color)
+{
+    if(Xpoint > paint->Width || Ypoint > paint->Height)
+        return;
+    UWORD X, Y;
+    switch(paint->Rotate)
+    {
+    case 0:
+        X = Xpoint;
+        Y = Ypoint;
+        break;
+    case 90:
+        X = paint->WidthMemory - Ypoint - 1;
+        Y = Xpoint;
+        break;
+    case 180:
+        X = paint->WidthMemory - Xpoint - 1;
+        Y = paint->HeightMemory - Ypoint - 1;
+        break;
+    case 270:
+        X = Ypoint;
+        Y = paint->HeightMemory - Xpoint - 1;
+        break;
+    default:
+        return;
+    }
+
+    switch(paint->Mirror)
+    {
+    case MIRROR_NONE:
+        break;
+    case MIRROR_HORIZONTAL:
+        X = paint->WidthMemory - X - 1;
+        break;
+    case MIRROR_VERTICAL:
+        Y = paint->HeightMemory - Y - 1;
+        break;
+    case MIRROR_ORIGIN:
+        X = paint->WidthMemory - X - 1;
+        Y = paint->HeightMemory - Y - 1;
+        break;
+    default:
+        return;
+    }
+
+    if(X > paint->WidthMemory || Y > paint->HeightMemory)
+        return;
+
+    if(paint->Scale == 2)
+    {
+        UDOUBLE Addr = X / 8 + Y * paint->WidthByte;
+        UBYTE Rdata = paint->Image[Addr];
+        if(Color == BLACK)
+            paint->Image[Addr] = Rdata & ~(0x80 >> (X % 8));
+        else
+            paint->Image[Addr] = Rdata | (0x80 >> (X % 8));
+    }
+    else if(paint->Scale == 4)
+    {
+        UDOUBLE Addr = X / 4 + Y * paint->WidthByte;
+        Color = Color % 4;
+        UBYTE Rdata = paint->Image[Addr];
+        Rdata = Rdata & (~(0xC0 >> ((X % 4) * 2)));
+        paint->Image[Addr] = Rdata | ((Color << 6) >> ((X % 4) * 2));
+    }
+    else if(paint->Scale == 7 || paint->Scale == 16)
+    {
+        UDOUBLE Addr = X / 2 + Y * paint->WidthByte;
+        UBYTE Rdata = paint->Image[Addr];
+        Rdata = Rdata & (~(0xF0 >> ((X % 2) * 4)));
+        paint->Image[Addr] = Rdata | ((Color << 4) >> ((X % 2) * 4));
+    }
+}
+
+static void Setup(UWORD rotate, UBYTE mirror, UBYTE scale)
+{
+    Paint_NewImage(image.data(), Width, Height, rotate, WHITE);
+    Paint_SetScale(scale);
+    Paint_SetMirroring(mirror);
+}
+
+static bool CheckSetPixel()
+{
+    mt19937 random(1);
+    bool same = true;
+    for(UWORD rotate : Rotations)
+    for(UBYTE mirror : Mirrors)
+    for(UBYTE scale : Scales)
+    for(UBYTE track : {0, 1})
+    {
+        Setup(rotate, mirror, scale);
+        Paint_SetDirtyTracking(track);
+        fill(image.begin(), image.end(), 0x5A);
+        fill(expected.begin(), expected.end(), 0x5A);
+        PAINT reference = Paint;
+        reference.Image = expected.data();
+        for(int i = 0; i < 200000; ++i)
+        {
+            // Past the edges too, so the bounds checks are compared as well
+            UWORD x = random() % (Paint.Width + 3);
+            UWORD y = random() % (Paint.Height + 3);
+            UWORD color = random() % 20;
+            Paint_SetPixel(x, y, color);
+            ReferenceSetPixel(&reference, x, y, color);
+        }
+        if(image != expected)
+        {
+            fprintf(stderr, "Paint_SetPixel differs for rotate %u mirror %u scale %u tracking %u\n", rotate, mirror, scale, track);
+            same = false;
+        }
+    }
+    return same;
+}
+
+template<typename Draw>
+static double TimeMs(unsigned int repeats, Draw draw)
+{
+    vector<double> times;
+    for(unsigned int repeat = 0; repeat < repeats; ++repeat)
+    {
+        steady_clock::time_point start = steady_clock::now();
+        draw();
+        times.push_back(duration<double, milli>(steady_clock::now() - start).count());
+    }
+    sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+static void Report(const char* name, const string& setup, double referenceMs, double libraryMs, unsigned long long pixels)
+{
+    printf("{\"commit\":\"%s\",\"case\":\"%s\",\"setup\":\"%s\",\"pixels\":%llu,\"reference_ms\":%.3f,\"library_ms\":%.3f,"
+        "\"reference_ns_per_pixel\":%.3f,\"library_ns_per_pixel\":%.3f,\"speedup\":%.2f}\n",
+        BENCH_COMMIT, name, setup.c_str(), pixels, referenceMs, libraryMs,
+        referenceMs * 1e6 / pixels, libraryMs * 1e6 / pixels, referenceMs / max(libraryMs, 1e-9));
+    fflush(stdout);
+}
+
+// Every pixel of the panel one at a time, in a checkerboard so both colour branches are taken,
+// without and then with dirty rectangle tracking
+static void BenchSetPixel(unsigned int repeats)
+{
+    for(UBYTE track : {0, 1})
+    for(UWORD rotate : Rotations)
+    for(UBYTE mirror : {MIRROR_NONE, MIRROR_ORIGIN})
+    for(UBYTE scale : {2, 4})
+    {
+        Setup(rotate, mirror, scale);
+        Paint_SetDirtyTracking(track);
+        PAINT reference = Paint;
+        reference.Image = expected.data();
+        UWORD width = Paint.Width;
+        UWORD height = Paint.Height;
+        double referenceMs = TimeMs(repeats, [&]()
+        {
+            for(UWORD y = 0; y < height; ++y)
+                for(UWORD x = 0; x < width; ++x)
+                    ReferenceSetPixel(&reference, x, y, ((x ^ y) & 1) != 0 ? WHITE : BLACK);
+        });
+        double libraryMs = TimeMs(repeats, [&]()
+        {
+            for(UWORD y = 0; y < height; ++y)
+                for(UWORD x = 0; x < width; ++x)
+                    Paint_SetPixel(x, y, ((x ^ y) & 1) != 0 ? WHITE : BLACK);
+        });
+        string setup = "rotate " + to_string(rotate) + " mirror " + to_string(mirror) + " scale " + to_string(scale)
+            + (track ? " tracked" : "");
+        Report("set-pixel", setup, referenceMs, libraryMs, (unsigned long long)width * height);
+    }
+}
+
+// The fills as they were, a pixel or a line at a time through the library's own unchanged routines
+static void ReferenceClear(UWORD color)
+{
+    for(UWORD y = 0; y < Paint.HeightByte; ++y)
+    {
+        for(UWORD x = 0; x < Paint.WidthByte; ++x)
+        {
+            UDOUBLE address = x + y * Paint.WidthByte;
+            if(Paint.Scale == 2)
+                Paint.Image[address] = color;
+            else if(Paint.Scale == 4)
+                Paint.Image[address] = (color << 6) | (color << 4) | (color << 2) | color;
+            else if(Paint.Scale == 7 || Paint.Scale == 16)
+                Paint.Image[address] = (color << 4) | color;
+        }
+    }
+}
+
+static void ReferenceClearWindows(UWORD xStart, UWORD yStart, UWORD xEnd, UWORD yEnd, UWORD color)
+{
+    for(UWORD y = yStart; y < yEnd; ++y)
+        for(UWORD x = xStart; x < xEnd; ++x)
+            Paint_SetPixel(x, y, color);
+}
+
+static void ReferenceFilledRectangle(UWORD xStart, UWORD yStart, UWORD xEnd, UWORD yEnd, UWORD color, DOT_PIXEL lineWidth)
+{
+    if(xStart > Paint.Width || yStart > Paint.Height || xEnd > Paint.Width || yEnd > Paint.Height)
+        return;
+    for(UWORD y = yStart; y < yEnd; ++y)
+        Paint_DrawLine(xStart, y, xEnd, y, color, lineWidth, LINE_STYLE_SOLID);
+}
+
+static void ReferenceFilledCircle(UWORD xCenter, UWORD yCenter, UWORD radius, UWORD color)
+{
+    if(xCenter > Paint.Width || yCenter >= Paint.Height)
+        return;
+    int16_t xCurrent = 0;
+    int16_t yCurrent = radius;
+    int16_t esp = 3 - (radius << 1);
+    while(xCurrent <= yCurrent)
+    {
+        for(int16_t s = xCurrent; s <= yCurrent; ++s)
+        {
+            Paint_DrawPoint(xCenter + xCurrent, yCenter + s, color, DOT_PIXEL_DFT, DOT_STYLE_DFT);
+            Paint_DrawPoint(xCenter - xCurrent, yCenter + s, color, DOT_PIXEL_DFT, DOT_STYLE_DFT);
+            Paint_DrawPoint(xCenter - s, yCenter + xCurrent, color, DOT_PIXEL_DFT, DOT_STYLE_DFT);
+            Paint_DrawPoint(xCenter - s, yCenter - xCurrent, color, DOT_PIXEL_DFT, DOT_STYLE_DFT);
+            Paint_DrawPoint(xCenter - xCurrent, yCenter - s, color, DOT_PIXEL_DFT, DOT_STYLE_DFT);
+            Paint_DrawPoint(xCenter + xCurrent, yCenter - s, color, DOT_PIXEL_DFT, DOT_STYLE_DFT);
+            Paint_DrawPoint(xCenter + s, yCenter - xCurrent, color, DOT_PIXEL_DFT, DOT_STYLE_DFT);
+            Paint_DrawPoint(xCenter + s, yCenter + xCurrent, color, DOT_PIXEL_DFT, DOT_STYLE_DFT);
+        }
+        if(esp < 0)
+            esp += 4 * xCurrent + 6;
+        else
+        {
+            esp += 10 + 4 * (xCurrent - yCurrent);
+            --yCurrent;
+        }
+        ++xCurrent;
+    }
+}
+
+// Near either edge a third of the time each, where the clipping is
+static UWORD RandomCoordinate(mt19937& random, UWORD limit)
+{
+    switch(random() % 3)
+    {
+    case 0:
+        return random() % 10;
+    case 1:
+        return limit + 3 - random() % 10;
+    }
+    return random() % (limit + 3);
+}
+
+// Draws the same thing with the reference into expected and the library into image
+template<typename Reference, typename Library>
+static void DrawBoth(Reference reference, Library library)
+{
+    Paint_SelectImage(expected.data());
+    reference();
+    Paint_SelectImage(image.data());
+    library();
+}
+
+// Random windows, rectangles and circles, partly off the image, in every orientation and scale.
+// Colours go past 15 too, which scales 7 and 16 draw a pixel at a time.
+static bool CheckFill()
+{
+    mt19937 random(2);
+    for(UWORD rotate : Rotations)
+    for(UBYTE mirror : Mirrors)
+    for(UBYTE scale : Scales)
+    {
+        Setup(rotate, mirror, scale);
+        fill(image.begin(), image.end(), 0x5A);
+        fill(expected.begin(), expected.end(), 0x5A);
+        for(int i = 0; i < 80; ++i)
+        {
+            UWORD x0 = RandomCoordinate(random, Paint.Width);
+            UWORD y0 = RandomCoordinate(random, Paint.Height);
+            UWORD x1 = RandomCoordinate(random, Paint.Width);
+            UWORD y1 = RandomCoordinate(random, Paint.Height);
+            UWORD color = random() % 20;
+            DOT_PIXEL lineWidth = (DOT_PIXEL)(1 + random() % 4);
+            UWORD radius = random() % 200;
+            switch(i % 4)
+            {
+            case 0:
+                DrawBoth([&]() { ReferenceClearWindows(x0, y0, x1, y1, color); },
+                    [&]() { Paint_ClearWindows(x0, y0, x1, y1, color); });
+                break;
+            case 1:
+                DrawBoth([&]() { ReferenceFilledRectangle(x0, y0, x1, y1, color, lineWidth); },
+                    [&]() { Paint_DrawRectangle(x0, y0, x1, y1, color, lineWidth, DRAW_FILL_FULL); });
+                break;
+            case 2:
+                DrawBoth([&]() { ReferenceFilledCircle(x0, y0, radius, color); },
+                    [&]() { Paint_DrawCircle(x0, y0, radius, color, lineWidth, DRAW_FILL_FULL); });
+                break;
+            default:
+                // Only now and then, so there is still something to draw over afterwards
+                if(i % 20 == 3)
+                    DrawBoth([&]() { ReferenceClear(color); }, [&]() { Paint_Clear(color); });
+                else
+                    DrawBoth([&]() { ReferenceClearWindows(x0, y0, x1, y0 + 1, color); },
+                        [&]() { Paint_FillSpan(x0, x1, y0, color); });
+                break;
+            }
+            if(image != expected)
+            {
+                fprintf(stderr, "fill %d differs for rotate %u mirror %u scale %u\n", i % 4, rotate, mirror, scale);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// A window most of the panel, a filled rectangle, a filled circle and a whole clear, in each
+// orientation that changes which way the rows run in memory
+static void BenchFill(unsigned int repeats)
+{
+    for(UWORD rotate : {ROTATE_0, ROTATE_90})
+    for(UBYTE scale : {2, 4})
+    {
+        Setup(rotate, MIRROR_NONE, scale);
+        UWORD width = Paint.Width;
+        UWORD height = Paint.Height;
+        string setup = "rotate " + to_string(rotate) + " scale " + to_string(scale);
+        double referenceMs, libraryMs;
+
+        Paint_SelectImage(expected.data());
+        referenceMs = TimeMs(repeats, [&]() { ReferenceClearWindows(13, 7, width - 13, height - 7, BLACK); });
+        Paint_SelectImage(image.data());
+        libraryMs = TimeMs(repeats, [&]() { Paint_ClearWindows(13, 7, width - 13, height - 7, BLACK); });
+        Report("clear-windows", setup, referenceMs, libraryMs, (unsigned long long)(width - 26) * (height - 14));
+
+        Paint_SelectImage(expected.data());
+        referenceMs = TimeMs(repeats, [&]() { ReferenceFilledRectangle(40, 30, width - 40, height - 30, WHITE, DOT_PIXEL_1X1); });
+        Paint_SelectImage(image.data());
+        libraryMs = TimeMs(repeats, [&]() { Paint_DrawRectangle(40, 30, width - 40, height - 30, WHITE, DOT_PIXEL_1X1, DRAW_FILL_FULL); });
+        Report("filled-rectangle", setup, referenceMs, libraryMs, (unsigned long long)(width - 79) * (height - 60));
+
+        UWORD radius = min(width, height) / 2 - 10;
+        Paint_SelectImage(expected.data());
+        referenceMs = TimeMs(repeats, [&]() { ReferenceFilledCircle(width / 2, height / 2, radius, BLACK); });
+        Paint_SelectImage(image.data());
+        libraryMs = TimeMs(repeats, [&]() { Paint_DrawCircle(width / 2, height / 2, radius, BLACK, DOT_PIXEL_1X1, DRAW_FILL_FULL); });
+        Report("filled-circle", setup, referenceMs, libraryMs, (unsigned long long)(3.14159265 * radius * radius));
+
+        Paint_SelectImage(expected.data());
+        referenceMs = TimeMs(repeats, [&]() { ReferenceClear(WHITE); });
+        Paint_SelectImage(image.data());
+        libraryMs = TimeMs(repeats, [&]() { Paint_Clear(WHITE); });
+        Report("clear", setup, referenceMs, libraryMs, (unsigned long long)width * height);
+    }
+}
+
+// Whole frame rotate and mirror of an 800x480 panel image drawn upright, against mapping every
+// pixel through Paint_SetPixel. Sizes not a multiple of 8 are checked too, they go a pixel at a time.
+static void ReferenceTransform(const vector<UBYTE>& source, UWORD width, UWORD height, UBYTE* target, UWORD rotate, UBYTE mirror)
+{
+    bool swap = rotate == ROTATE_90 || rotate == ROTATE_270;
+    UWORD widthMemory = swap ? height : width;
+    UWORD heightMemory = swap ? width : height;
+    UDOUBLE widthByte = (width + 7) / 8;
+    memset(target, 0, (UDOUBLE)((widthMemory + 7) / 8) * heightMemory);
+    Paint_NewImage(target, widthMemory, heightMemory, rotate, WHITE);
+    Paint_SetMirroring(mirror);
+    for(UWORD y = 0; y < height; ++y)
+        for(UWORD x = 0; x < width; ++x)
+            Paint_SetPixel(x, y, (source[x / 8 + y * widthByte] & (0x80 >> (x % 8))) != 0 ? WHITE : BLACK);
+}
+
+static vector<UBYTE> RandomImage(mt19937& random, UWORD width, UWORD height)
+{
+    vector<UBYTE> source((UDOUBLE)((width + 7) / 8) * height);
+    for(UBYTE& byte : source)
+        byte = random();
+    // The bits past the right edge aren't part of the image
+    if(width % 8 != 0)
+        for(UWORD y = 0; y < height; ++y)
+            source[(y + 1) * ((width + 7) / 8) - 1] &= 0xFF << (8 - width % 8);
+    return source;
+}
+
+static bool CheckTransform()
+{
+    mt19937 random(3);
+    const UWORD sizes[][2] = {{Width, Height}, {Height, Width}, {16, 8}, {803, 475}, {13, 21}};
+    for(auto& size : sizes)
+    {
+        vector<UBYTE> source = RandomImage(random, size[0], size[1]);
+        for(UWORD rotate : Rotations)
+        for(UBYTE mirror : Mirrors)
+        {
+            Paint_TransformImage(source.data(), size[0], size[1], image.data(), rotate, mirror);
+            ReferenceTransform(source, size[0], size[1], expected.data(), rotate, mirror);
+            if(image != expected)
+            {
+                fprintf(stderr, "Paint_TransformImage differs for %ux%u rotate %u mirror %u\n", size[0], size[1], rotate, mirror);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void BenchTransform(unsigned int repeats)
+{
+    mt19937 random(4);
+#if defined(__SSE2__)
+    const char* kernel = "sse2";
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const char* kernel = "neon";
+#else
+    const char* kernel = "scalar";
+#endif
+    for(UWORD rotate : Rotations)
+    for(UBYTE mirror : {MIRROR_NONE, MIRROR_HORIZONTAL})
+    {
+        // Drawn the way the frame hangs, so portrait for 90 and 270
+        bool swap = rotate == ROTATE_90 || rotate == ROTATE_270;
+        UWORD width = swap ? Height : Width;
+        UWORD height = swap ? Width : Height;
+        vector<UBYTE> source = RandomImage(random, width, height);
+        double referenceMs = TimeMs(repeats, [&]() { ReferenceTransform(source, width, height, expected.data(), rotate, mirror); });
+        double libraryMs = TimeMs(repeats, [&]() { Paint_TransformImage(source.data(), width, height, image.data(), rotate, mirror); });
+        string setup = "rotate " + to_string(rotate) + " mirror " + to_string(mirror) + " " + kernel;
+        Report("transform", setup, referenceMs, libraryMs, (unsigned long long)width * height);
+    }
+}
+
+// Each thread draws a scene of its own into an image of its own through the PaintCtx_ functions,
+// all at once, and every image has to come out as it does drawn on one thread. The global Paint
+// is drawn into on the main thread meanwhile, so the wrappers are in the mix too.
+static constexpr unsigned int SceneThreads = 4;
+
+static void DrawScene(PAINT* paint, UBYTE* buffer, unsigned int scene)
+{
+    mt19937 random(100 + scene);
+    PaintCtx_NewImage(paint, buffer, Width, Height, Rotations[scene % 4], WHITE);
+    PaintCtx_SetMirroring(paint, Mirrors[(scene / 4) % 4]);
+    PaintCtx_SetScale(paint, scene % 2 == 0 ? 2 : 4);
+    PaintCtx_Clear(paint, WHITE);
+    for(int i = 0; i < 200; ++i)
+    {
+        UWORD x0 = random() % paint->Width;
+        UWORD y0 = random() % paint->Height;
+        UWORD x1 = random() % paint->Width;
+        UWORD y1 = random() % paint->Height;
+        UWORD color = (i / 5) % 2 == 0 ? BLACK : WHITE;
+        DOT_PIXEL lineWidth = (DOT_PIXEL)(1 + random() % 3);
+        switch(i % 5)
+        {
+        case 0:
+            PaintCtx_DrawLine(paint, x0, y0, x1, y1, color, lineWidth, i % 2 == 0 ? LINE_STYLE_SOLID : LINE_STYLE_DOTTED);
+            break;
+        case 1:
+            PaintCtx_DrawRectangle(paint, x0, y0, x1, y1, color, lineWidth, i % 2 == 0 ? DRAW_FILL_FULL : DRAW_FILL_EMPTY);
+            break;
+        case 2:
+            PaintCtx_DrawCircle(paint, x0, y0, random() % 80, color, lineWidth, i % 2 == 0 ? DRAW_FILL_FULL : DRAW_FILL_EMPTY);
+            break;
+        case 3:
+            PaintCtx_DrawString_EN(paint, x0, y0, "PiArtFrame", &Font16, BLACK, WHITE);
+            break;
+        default:
+            PaintCtx_DrawNum(paint, x0, y0, (int32_t)random() % 100000, &Font12, WHITE, BLACK);
+            break;
+        }
+    }
+}
+
+// A few of everything through the Paint_ wrappers
+static void DrawGlobalScene(UBYTE* buffer)
+{
+    Paint_SelectImage(buffer);
+    Paint_Clear(WHITE);
+    for(UWORD i = 0; i < 40; ++i)
+    {
+        Paint_DrawLine(i * 10, 0, Paint.Width - 1, i * 15, BLACK, DOT_PIXEL_2X2, LINE_STYLE_SOLID);
+        Paint_DrawRectangle(i * 11, i * 17, i * 11 + 60, i * 17 + 40, i % 2 == 0 ? BLACK : WHITE, DOT_PIXEL_1X1, DRAW_FILL_FULL);
+        Paint_DrawCircle(i * 9, Paint.Height - i * 12, 30, BLACK, DOT_PIXEL_1X1, DRAW_FILL_EMPTY);
+        Paint_DrawString_EN(i * 7, i * 13, "PiArtFrame", &Font12, BLACK, WHITE);
+        Paint_DrawNum(i * 5, i * 19, i * 1234, &Font8, WHITE, BLACK);
+    }
+}
+
+static bool CheckThreads()
+{
+    vector<vector<UBYTE>> references(SceneThreads, vector<UBYTE>(Width * (Height + 1)));
+    vector<vector<UBYTE>> images(SceneThreads, vector<UBYTE>(Width * (Height + 1)));
+    for(unsigned int scene = 0; scene < SceneThreads; ++scene)
+    {
+        PAINT paint = {};
+        DrawScene(&paint, references[scene].data(), scene);
+    }
+    Setup(ROTATE_90, MIRROR_HORIZONTAL, 2);
+    fill(image.begin(), image.end(), 0);
+    fill(expected.begin(), expected.end(), 0);
+    DrawGlobalScene(expected.data());
+
+    for(int round = 0; round < 20; ++round)
+    {
+        vector<thread> threads;
+        for(unsigned int scene = 0; scene < SceneThreads; ++scene)
+            threads.emplace_back([&images, scene]()
+            {
+                PAINT paint = {};
+                DrawScene(&paint, images[scene].data(), scene);
+            });
+        DrawGlobalScene(image.data());
+        for(thread& worker : threads)
+            worker.join();
+
+        for(unsigned int scene = 0; scene < SceneThreads; ++scene)
+        {
+            if(images[scene] != references[scene])
+            {
+                fprintf(stderr, "scene %u drawn on a thread of its own differs in round %d\n", scene, round);
+                return false;
+            }
+        }
+        if(image != expected)
+        {
+            fprintf(stderr, "scene drawn through the global Paint differs in round %d\n", round);
+            return false;
+        }
+    }
+    return true;
+}
+
+// The scenes one after another on one thread, against a thread each
+static void BenchThreads(unsigned int repeats)
+{
+    vector<vector<UBYTE>> images(SceneThreads, vector<UBYTE>(Width * (Height + 1)));
+    double referenceMs = TimeMs(repeats, [&]()
+    {
+        for(unsigned int scene = 0; scene < SceneThreads; ++scene)
+        {
+            PAINT paint = {};
+            DrawScene(&paint, images[scene].data(), scene);
+        }
+    });
+    double libraryMs = TimeMs(repeats, [&]()
+    {
+        vector<thread> threads;
+        for(unsigned int scene = 0; scene < SceneThreads; ++scene)
+            threads.emplace_back([&images, scene]()
+            {
+                PAINT paint = {};
+                DrawScene(&paint, images[scene].data(), scene);
+            });
+        for(thread& worker : threads)
+            worker.join();
+    });
+    string setup = to_string(SceneThreads) + " threads";
+    Report("threads", setup, referenceMs, libraryMs, (unsigned long long)Width * Height * SceneThreads);
+}
+
+// Paint_DrawChar as it was, a Paint_SetPixel per pixel
+static void ReferenceDrawChar(UWORD xPoint, UWORD yPoint, char character, sFONT* font, UWORD foreground, UWORD background)
+{
+    if(xPoint > Paint.Width || yPoint > Paint.Height)
+        return;
+    UWORD rowBytes = (font->Width + 7) / 8;
+    const unsigned char* glyph = &font->table[(character - ' ') * font->Height * rowBytes];
+    for(UWORD row = 0; row < font->Height; ++row)
+        for(UWORD column = 0; column < font->Width; ++column)
+        {
+            bool set = (glyph[row * rowBytes + column / 8] & (0x80 >> (column % 8))) != 0;
+            if(set)
+                Paint_SetPixel(xPoint + column, yPoint + row, foreground);
+            else if(background != FONT_BACKGROUND)
+                Paint_SetPixel(xPoint + column, yPoint + row, background);
+        }
+}
+
+static sFONT* const Fonts[] = {&Font8, &Font12, &Font16, &Font20, &Font24};
+
+// Random characters in every font, orientation and scale, with the background left alone and
+// drawn, partly off the image now and then where they go a pixel at a time
+static bool CheckText()
+{
+    mt19937 random(5);
+    for(UWORD rotate : Rotations)
+    for(UBYTE mirror : Mirrors)
+    for(UBYTE scale : {2, 4})
+    {
+        Setup(rotate, mirror, scale);
+        fill(image.begin(), image.end(), 0x5A);
+        fill(expected.begin(), expected.end(), 0x5A);
+        for(int i = 0; i < 2000; ++i)
+        {
+            sFONT* font = Fonts[random() % 5];
+            UWORD x = RandomCoordinate(random, Paint.Width);
+            UWORD y = RandomCoordinate(random, Paint.Height);
+            char character = (char)(' ' + random() % 95);
+            UWORD foreground = random() % 2 == 0 ? BLACK : WHITE;
+            UWORD background = random() % 2 == 0 ? FONT_BACKGROUND : (random() % 2 == 0 ? BLACK : GRAY3);
+            DrawBoth([&]() { ReferenceDrawChar(x, y, character, font, foreground, background); },
+                [&]() { Paint_DrawChar(x, y, character, font, foreground, background); });
+        }
+        if(image != expected)
+        {
+            fprintf(stderr, "Paint_DrawChar differs for rotate %u mirror %u scale %u\n", rotate, mirror, scale);
+            return false;
+        }
+    }
+    return true;
+}
+
+// A whole screen of Font24, the way Paint_DrawString_EN lays it out
+static void BenchText(unsigned int repeats)
+{
+    for(UWORD rotate : {ROTATE_0, ROTATE_90})
+    for(UWORD background : {FONT_BACKGROUND, BLACK})
+    {
+        Setup(rotate, MIRROR_NONE, 2);
+        UWORD columns = Paint.Width / Font24.Width;
+        UWORD rows = Paint.Height / Font24.Height;
+        auto drawScreen = [&](bool reference)
+        {
+            for(UWORD row = 0; row < rows; ++row)
+                for(UWORD column = 0; column < columns; ++column)
+                {
+                    char character = (char)(' ' + (row * columns + column) % 95);
+                    UWORD x = column * Font24.Width;
+                    UWORD y = row * Font24.Height;
+                    if(reference)
+                        ReferenceDrawChar(x, y, character, &Font24, BLACK, background);
+                    else
+                        Paint_DrawChar(x, y, character, &Font24, BLACK, background);
+                }
+        };
+        Paint_SelectImage(expected.data());
+        double referenceMs = TimeMs(repeats, [&]() { drawScreen(true); });
+        Paint_SelectImage(image.data());
+        double libraryMs = TimeMs(repeats, [&]() { drawScreen(false); });
+        string setup = "rotate " + to_string(rotate) + (background == FONT_BACKGROUND ? " transparent" : " opaque");
+        Report("text", setup, referenceMs, libraryMs, (unsigned long long)columns * rows * Font24.Width * Font24.Height);
+    }
+}
+
+// A made up GB2312 font, as there is none in the tree: the printable ASCII characters and 1000
+// two byte codes in shuffled order, a few of them listed twice, with random 24x24 glyphs
+static cFONT SyntheticFont()
+{
+    mt19937 random(6);
+    vector<pair<UBYTE, UBYTE>> codes;
+    for(int c = ' '; c <= '~'; ++c)
+        codes.push_back({(UBYTE)c, 0});
+    for(int k = 0; k < 1000; ++k)
+        codes.push_back({(UBYTE)(0xB0 + k / 94), (UBYTE)(0xA1 + k % 94)});
+    shuffle(codes.begin(), codes.end(), random);
+    for(int k = 0; k < 20; ++k)
+        codes.push_back(codes[random() % codes.size()]);
+
+    CH_CN* table = (CH_CN*)calloc(codes.size(), sizeof(CH_CN));
+    for(size_t i = 0; i < codes.size(); ++i)
+    {
+        char* entry = (char*)&table[i];
+        entry[0] = (char)codes[i].first;
+        entry[1] = (char)codes[i].second;
+        for(int byte = 0; byte < 24 * 3; ++byte)
+            entry[2 + byte] = (char)random();
+    }
+    cFONT font = {table, (uint16_t)codes.size(), 12, 24, 24};
+    return font;
+}
+
+// Mixed ASCII and two byte characters, now and then one the font doesn't have
+static string MixedString(mt19937& random, size_t length)
+{
+    string text;
+    while(text.size() < length)
+    {
+        if(random() % 3 == 0)
+            text += (char)(' ' + random() % 95);
+        else
+        {
+            int k = random() % 1010;
+            text += (char)(0xB0 + k / 94);
+            text += (char)(0xA1 + k % 94);
+        }
+    }
+    return text;
+}
+
+// Paint_DrawString_CN as it was, scanning the table for every character and a Paint_SetPixel per
+// pixel, with the lead byte tested unsigned as on the Pi
+static void ReferenceDrawStringCN(UWORD xStart, UWORD yStart, const char* text, cFONT* font, UWORD foreground, UWORD background)
+{
+    int x = xStart, y = yStart;
+    while(*text != 0)
+    {
+        bool single = (UBYTE)*text <= 0x7F;
+        for(int num = 0; num < font->size; ++num)
+        {
+            if(text[0] != font->table[num].index[0] || (!single && text[1] != font->table[num].index[1]))
+                continue;
+            const char* glyph = font->table[num].matrix;
+            UWORD rowBytes = (font->Width + 7) / 8;
+            for(int row = 0; row < font->Height; ++row)
+                for(int column = 0; column < font->Width; ++column)
+                {
+                    if(glyph[row * rowBytes + column / 8] & (0x80 >> (column % 8)))
+                        Paint_SetPixel(x + column, y + row, foreground);
+                    else if(background != FONT_BACKGROUND)
+                        Paint_SetPixel(x + column, y + row, background);
+                }
+            break;
+        }
+        text += single ? 1 : 2;
+        x += single ? font->ASCII_Width : font->Width;
+    }
+}
+
+static bool CheckStringCN()
+{
+    static cFONT font = SyntheticFont();
+    mt19937 random(7);
+    for(UWORD rotate : Rotations)
+    for(UBYTE mirror : Mirrors)
+    for(UBYTE scale : {2, 4})
+    {
+        Setup(rotate, mirror, scale);
+        fill(image.begin(), image.end(), 0x5A);
+        fill(expected.begin(), expected.end(), 0x5A);
+        for(int i = 0; i < 100; ++i)
+        {
+            string text = MixedString(random, random() % 40);
+            UWORD x = RandomCoordinate(random, Paint.Width);
+            UWORD y = RandomCoordinate(random, Paint.Height);
+            UWORD foreground = random() % 2 == 0 ? BLACK : WHITE;
+            UWORD background = random() % 2 == 0 ? FONT_BACKGROUND : BLACK;
+            DrawBoth([&]() { ReferenceDrawStringCN(x, y, text.c_str(), &font, foreground, background); },
+                [&]() { Paint_DrawString_CN(x, y, text.c_str(), &font, foreground, background); });
+        }
+        if(image != expected)
+        {
+            fprintf(stderr, "Paint_DrawString_CN differs for rotate %u mirror %u scale %u\n", rotate, mirror, scale);
+            return false;
+        }
+    }
+    return true;
+}
+
+// A whole screen of long mixed lines, in a font of 1115 glyphs
+static void BenchStringCN(unsigned int repeats)
+{
+    static cFONT font = SyntheticFont();
+    mt19937 random(8);
+    for(UWORD rotate : {ROTATE_0, ROTATE_90})
+    for(UWORD background : {FONT_BACKGROUND, BLACK})
+    {
+        Setup(rotate, MIRROR_NONE, 2);
+        UWORD rows = Paint.Height / font.Height;
+        vector<string> lines;
+        unsigned long long pixels = 0;
+        for(UWORD row = 0; row < rows; ++row)
+        {
+            // Cut where the next character would run off the right edge
+            string text = MixedString(random, 2 * Paint.Width / font.ASCII_Width);
+            size_t end = 0;
+            UWORD x = 0;
+            while(end < text.size())
+            {
+                bool single = (UBYTE)text[end] <= 0x7F;
+                UWORD advance = single ? font.ASCII_Width : font.Width;
+                if(x + max(advance, font.Width) > Paint.Width)
+                    break;
+                x += advance;
+                end += single ? 1 : 2;
+            }
+            lines.push_back(text.substr(0, end));
+            pixels += (unsigned long long)x * font.Height;
+        }
+        auto drawScreen = [&](bool reference)
+        {
+            for(UWORD row = 0; row < rows; ++row)
+            {
+                if(reference)
+                    ReferenceDrawStringCN(0, row * font.Height, lines[row].c_str(), &font, BLACK, background);
+                else
+                    Paint_DrawString_CN(0, row * font.Height, lines[row].c_str(), &font, BLACK, background);
+            }
+        };
+        Paint_SelectImage(expected.data());
+        double referenceMs = TimeMs(repeats, [&]() { drawScreen(true); });
+        Paint_SelectImage(image.data());
+        double libraryMs = TimeMs(repeats, [&]() { drawScreen(false); });
+        string setup = "rotate " + to_string(rotate) + (background == FONT_BACKGROUND ? " transparent" : " opaque");
+        Report("string-cn", setup, referenceMs, libraryMs, pixels);
+    }
+}
+
+// Every byte a primitive changes has to be inside one of the dirty rectangles, which stay within
+// the cap, byte aligned and apart from each other. Shapes keep clear of the right and bottom edges,
+// where Paint_SetPixel lets writes one past the image through untracked.
+static bool CheckDirtyRects(UWORD rotate, UBYTE mirror, UBYTE scale, const vector<UBYTE>& before, int step)
+{
+    PAINT_RECT rects[PAINT_DIRTY_MAX];
+    UBYTE count = Paint_GetDirty(rects);
+    UWORD bitsPerPixel = scale == 2 ? 1 : 2;
+    for(UBYTE i = 0; i < count; ++i)
+    {
+        const PAINT_RECT& rect = rects[i];
+        if(rect.Xstart % 8 != 0 || rect.Xend % 8 != 0 || rect.Xstart >= rect.Xend || rect.Ystart >= rect.Yend ||
+            rect.Xend > (Paint.WidthMemory + 7) / 8 * 8 || rect.Yend > Paint.HeightMemory)
+        {
+            fprintf(stderr, "dirty rectangle %u,%u-%u,%u is malformed\n", rect.Xstart, rect.Ystart, rect.Xend, rect.Yend);
+            return false;
+        }
+        for(UBYTE j = 0; j < i; ++j)
+            if(rect.Xstart <= rects[j].Xend && rects[j].Xstart <= rect.Xend && rect.Ystart <= rects[j].Yend && rects[j].Ystart <= rect.Yend)
+            {
+                fprintf(stderr, "dirty rectangles %u and %u touch\n", i, j);
+                return false;
+            }
+    }
+    for(UWORD y = 0; y < Paint.HeightMemory; ++y)
+        for(UWORD byte = 0; byte < Paint.WidthByte; ++byte)
+        {
+            size_t address = (size_t)y * Paint.WidthByte + byte;
+            if(image[address] == before[address])
+                continue;
+            bool covered = false;
+            for(UBYTE i = 0; i < count && !covered; ++i)
+                covered = y >= rects[i].Ystart && y < rects[i].Yend &&
+                    byte >= rects[i].Xstart * bitsPerPixel / 8 && byte < rects[i].Xend * bitsPerPixel / 8;
+            if(!covered)
+            {
+                fprintf(stderr, "step %d changed byte %u of row %u outside the dirty rectangles for rotate %u mirror %u scale %u\n",
+                    step, byte, y, rotate, mirror, scale);
+                return false;
+            }
+        }
+    return true;
+}
+
+static bool CheckDirty()
+{
+    static cFONT font = SyntheticFont();
+    mt19937 random(9);
+    for(UWORD rotate : Rotations)
+    for(UBYTE mirror : Mirrors)
+    for(UBYTE scale : {2, 4})
+    {
+        Setup(rotate, mirror, scale);
+        Paint_SelectImage(image.data());
+        Paint_SetDirtyTracking(1);
+        for(size_t i = 0; i < image.size(); ++i)
+            image[i] = random();
+        // Kept short, so the list both fills up and gets reset along the way
+        for(int step = 0; step < 300; ++step)
+        {
+            if(step % 25 == 0)
+                Paint_ResetDirty();
+            vector<UBYTE> before = image;
+            UWORD x0 = random() % (Paint.Width - 60);
+            UWORD y0 = random() % (Paint.Height - 60);
+            UWORD x1 = random() % (Paint.Width - 60);
+            UWORD y1 = random() % (Paint.Height - 60);
+            UWORD color = random() % 2 == 0 ? BLACK : WHITE;
+            DOT_PIXEL lineWidth = (DOT_PIXEL)(1 + random() % 4);
+            switch(step % 9)
+            {
+            case 0:
+                Paint_SetPixel(x0, y0, color);
+                break;
+            case 1:
+                Paint_DrawPoint(x0, y0, color, lineWidth, random() % 2 == 0 ? DOT_FILL_AROUND : DOT_FILL_RIGHTUP);
+                break;
+            case 2:
+                Paint_DrawLine(x0, y0, x1, y1, color, lineWidth, LINE_STYLE_SOLID);
+                break;
+            case 3:
+                Paint_DrawRectangle(x0, y0, x0 + random() % 50, y0 + random() % 50, color, lineWidth,
+                    random() % 2 == 0 ? DRAW_FILL_FULL : DRAW_FILL_EMPTY);
+                break;
+            case 4:
+                Paint_DrawCircle(x0 + 30, y0 + 30, random() % 25, color, lineWidth, random() % 2 == 0 ? DRAW_FILL_FULL : DRAW_FILL_EMPTY);
+                break;
+            case 5:
+                Paint_DrawChar(x0, y0, (char)(' ' + random() % 95), &Font24, color, random() % 2 == 0 ? FONT_BACKGROUND : BLACK);
+                break;
+            case 6:
+                Paint_DrawString_CN(x0, y0, MixedString(random, 2).c_str(), &font, color, BLACK);
+                break;
+            case 7:
+                Paint_FillSpan(x0, x1, y0, color);
+                break;
+            default:
+                if(step % 50 == 8)
+                    Paint_Clear(color);
+                else
+                    Paint_ClearWindows(x0, y0, x1, y1, color);
+                break;
+            }
+            if(!CheckDirtyRects(rotate, mirror, scale, before, step))
+                return false;
+        }
+    }
+    return true;
+}
+
+// What a partial refresh would send after the frame has been drawn once: a clock and a status dot
+// redrawn, against the whole frame
+static void BenchDirty(unsigned int repeats)
+{
+    for(UWORD rotate : {ROTATE_0, ROTATE_90})
+    {
+        Setup(rotate, MIRROR_NONE, 2);
+        Paint_Clear(WHITE);
+        DrawScene(&Paint, image.data(), 0);
+        Setup(rotate, MIRROR_NONE, 2);
+        Paint_SetDirtyTracking(1);
+        PAINT_RECT rects[PAINT_DIRTY_MAX];
+        UBYTE count = 0;
+        double libraryMs = TimeMs(repeats, [&]()
+        {
+            Paint_ResetDirty();
+            Paint_DrawString_EN(20, 20, "12:34:56", &Font24, WHITE, BLACK);
+            Paint_DrawCircle(Paint.Width - 30, 30, 10, BLACK, DOT_PIXEL_1X1, DRAW_FILL_FULL);
+            count = Paint_GetDirty(rects);
+            for(UBYTE i = 0; i < count; ++i)
+                Paint_CopyRect(&rects[i], expected.data());
+        });
+        unsigned long long dirtyBytes = 0;
+        for(UBYTE i = 0; i < count; ++i)
+            dirtyBytes += (unsigned long long)(rects[i].Xend - rects[i].Xstart) / 8 * (rects[i].Yend - rects[i].Ystart);
+        printf("{\"commit\":\"%s\",\"case\":\"dirty\",\"setup\":\"rotate %u\",\"rects\":%u,\"dirty_bytes\":%llu,"
+            "\"frame_bytes\":%llu,\"library_ms\":%.3f}\n",
+            BENCH_COMMIT, rotate, count, dirtyBytes, (unsigned long long)Paint.WidthByte * Paint.HeightByte, libraryMs);
+        fflush(stdout);
+    }
+}
+
+struct BenchCase
+{
+    const char* name;
+    bool (*check)();
+    void (*bench)(unsigned int repeats);
+};
+
+static const BenchCase Cases[] = {
+    {"set-pixel", CheckSetPixel, BenchSetPixel},
+    {"fill", CheckFill, BenchFill},
+    {"transform", CheckTransform, BenchTransform},
+    {"threads", CheckThreads, BenchThreads},
+    {"text", CheckText, BenchText},
+    {"string-cn", CheckStringCN, BenchStringCN},
+    {"dirty", CheckDirty, BenchDirty},
+};
+
+int main(int argc, char* argv[])
+{
+    unsigned int repeats = 5;
+    const char* onlyCase = NULL;
+    for(int i = 1; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "--repeats") == 0 && i + 1 < argc)
+            repeats = max(1, atoi(argv[++i]));
+        else if(strcmp(argv[i], "--case") == 0 && i + 1 < argc)
+            onlyCase = argv[++i];
+        else
+        {
+            fprintf(stderr, "usage: %s [--repeats N] [--case NAME]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    int failures = 0;
+    for(const BenchCase& benchCase : Cases)
+    {
+        if(onlyCase != NULL && strcmp(onlyCase, benchCase.name) != 0)
+            continue;
+        if(!benchCase.check())
+        {
+            ++failures;
+            continue;
+        }
+        benchCase.bench(repeats);
+    }
+    return failures == 0 ? 0 : 1;
+}
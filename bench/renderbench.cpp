@@ -0,0 +1,364 @@
+// Headless render benchmark: renders a fixed corpus of views with each renderer variant and prints
+// one JSON object per line, so results can be compared from commit to commit. Built by `make bench`.
+//
+//   bench/renderbench [--repeats N] [--seed N] [--view NAME] [--variant NAME] [--log]
+//
+// Every view/variant pair runs in a child process of its own, so peak RSS is that of the pair alone.
+// A few renderer checks run first, perturbation against a reference orbit that escapes at once and a
+// progressive frame that settles after trying every quadrant. Any failed check, or a frame that comes
+// out all one colour, exits 1.
+#include "mandelbrot.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifndef BENCH_COMMIT
+#define BENCH_COMMIT "unknown"
+#endif
+
+using namespace std;
+using namespace chrono;
+
+static constexpr UWORD Width = 800;
+static constexpr UWORD Height = 480;
+
+// A view is reached from the whole set by zooming into the quadrant holding the target each time,
+// so the path stays the same whatever the zoom scoring does. A view with no target is instead
+// a sequence of frames zoomed by ZoomOnInterestingArea from a fixed seed.
+struct BenchView
+{
+    const char* name;
+    double targetX;
+    double targetY;
+    unsigned int level;
+    bool sequence;
+};
+
+static const BenchView Views[] = {
+    // Seahorse valley, busy at both of these depths
+    {"shallow", -0.743643887037151, 0.131825904205330, 2, false},
+    {"mid", -0.743643887037151, 0.131825904205330, 14, false},
+    // The last level before the pixel spacing needs double-double. Past 1e-9 across, most of seahorse
+    // valley needs far more than the depth-based budget and the frame is all interior, so this one
+    // zooms into a period 101 minibrot about that size, which leaves the frame mixed.
+    {"near-double-limit", -0.74363311088944462, 0.13183537588812713, 31, false},
+    // The period 3 minibrot on the real axis fills most of the frame with interior the cardioid test misses
+    {"heavy-interior", -1.7548776662466927, 0, 6, false},
+    {"zoom-sequence", 0, 0, 12, true},
+};
+
+struct BenchVariant
+{
+    const char* name;
+    MandelbrotSet::Kernel kernel;
+    MandelbrotSet::RenderMode mode;
+    unsigned int threads;
+};
+
+static const BenchVariant Variants[] = {
+    {"simd", MandelbrotSet::Kernel::Simd, MandelbrotSet::RenderMode::BruteForce, 0},
+    {"simd-1thread", MandelbrotSet::Kernel::Simd, MandelbrotSet::RenderMode::BruteForce, 1},
+    {"scalar", MandelbrotSet::Kernel::Scalar, MandelbrotSet::RenderMode::BruteForce, 0},
+    {"subdivide", MandelbrotSet::Kernel::Simd, MandelbrotSet::RenderMode::Subdivide, 0},
+    {"trace", MandelbrotSet::Kernel::Simd, MandelbrotSet::RenderMode::Trace, 0},
+};
+
+struct FrameResult
+{
+    double ms;
+    unsigned long long pixels;
+    unsigned long long iterations;
+    unsigned long long white;
+};
+
+static void Configure(MandelbrotSet& mandelbrot, const BenchVariant& variant, UBYTE* image, uint32_t seed)
+{
+    mandelbrot.SetRender(image);
+    mandelbrot.SetKernel(variant.kernel);
+    mandelbrot.SetRenderMode(variant.mode);
+    mandelbrot.SetThreadCount(variant.threads);
+    mandelbrot.SetRandomSeed(seed);
+}
+
+// Quadrant digits of the path, as in the tile cache: bit 0 set for right, bit 1 for down
+static string ZoomTowards(MandelbrotSet& mandelbrot, const BenchView& view)
+{
+    string path;
+    for(unsigned int level = 0; level < view.level; ++level)
+    {
+        MandelbrotSet::ViewState state = mandelbrot.GetViewState();
+        int xDirection = view.targetX >= state.x.ToDouble() ? 1 : -1;
+        int yDirection = view.targetY >= state.y.ToDouble() ? 1 : -1;
+        mandelbrot.ZoomIntoQuadrant(xDirection, yDirection);
+        path += (char)('0' + (xDirection > 0 ? 1 : 0) + (yDirection < 0 ? 2 : 0));
+    }
+    return path;
+}
+
+static FrameResult RenderFrame(MandelbrotSet& mandelbrot)
+{
+    steady_clock::time_point start = steady_clock::now();
+    mandelbrot.Render(Width, Height);
+    FrameResult result;
+    result.ms = duration<double, milli>(steady_clock::now() - start).count();
+    result.pixels = (unsigned long long)Width * Height;
+    result.iterations = mandelbrot.GetFrameStats().iterations;
+    result.white = 0;
+    const UBYTE* image = mandelbrot.GetRender();
+    for(unsigned int byte = 0; byte < ((Width + 7) / 8) * Height; ++byte)
+        result.white += __builtin_popcount(image[byte]);
+    return result;
+}
+
+// Fails when a frame came out all one colour, which would only measure how fast the budget runs out
+static bool RunPair(const BenchView& view, const BenchVariant& variant, unsigned int repeats, uint32_t seed, FILE* out)
+{
+    static UBYTE image[((Width + 7) / 8) * Height];
+    vector<FrameResult> frames;
+    string path;
+
+    if(view.sequence)
+    {
+        // One run through the whole sequence, each frame building on the one before like on the panel
+        MandelbrotSet mandelbrot;
+        Configure(mandelbrot, variant, image, seed);
+        for(unsigned int frame = 0; frame < view.level; ++frame)
+        {
+            if(frame > 0)
+            {
+                mandelbrot.ZoomOnInterestingArea();
+                int quadrant = (int)(mandelbrot.GetViewState().zoomPath & 3);
+                path += (char)('0' + quadrant);
+            }
+            frames.push_back(RenderFrame(mandelbrot));
+        }
+    }
+    else
+    {
+        // A fresh set every time, so nothing is carried over from the previous repeat
+        for(unsigned int repeat = 0; repeat < repeats; ++repeat)
+        {
+            MandelbrotSet mandelbrot;
+            Configure(mandelbrot, variant, image, seed);
+            path = ZoomTowards(mandelbrot, view);
+            frames.push_back(RenderFrame(mandelbrot));
+        }
+    }
+
+    double totalMs = 0;
+    unsigned long long pixels = 0;
+    unsigned long long iterations = 0;
+    vector<double> times;
+    for(const FrameResult& frame : frames)
+    {
+        totalMs += frame.ms;
+        pixels += frame.pixels;
+        iterations += frame.iterations;
+        times.push_back(frame.ms);
+    }
+    sort(times.begin(), times.end());
+    double seconds = max(totalMs, 1e-6) / 1000.0;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    fprintf(out, "{\"commit\":\"%s\",\"view\":\"%s\",\"variant\":\"%s\",\"path\":\"%s\",\"width\":%u,\"height\":%u,"
+        "\"frames\":%zu,\"ms_per_frame\":%.3f,\"ms_median\":%.3f,\"ms_min\":%.3f,\"pixels_per_s\":%.0f,"
+        "\"iterations_per_s\":%.0f,\"iterations\":%llu,\"peak_rss_kb\":%ld,\"seed\":%u}\n",
+        BENCH_COMMIT, view.name, variant.name, path.c_str(), Width, Height,
+        frames.size(), totalMs / frames.size(), times[times.size() / 2], times[0], pixels / seconds,
+        iterations / seconds, iterations, usage.ru_maxrss, seed);
+    fflush(out);
+
+    for(unsigned int frame = 0; frame < frames.size(); ++frame)
+    {
+        if(frames[frame].white == 0 || frames[frame].white == frames[frame].pixels)
+        {
+            fprintf(stderr, "%s/%s: frame %u is all %s\n", view.name, variant.name, frame,
+                frames[frame].white == 0 ? "black" : "white");
+            return false;
+        }
+    }
+    return true;
+}
+
+// A reference point that escapes at once leaves an orbit of only Z_0 and Z_1, so every pixel
+// rebases on its first step. Checks such pixels against plain double iteration, which they can
+// only differ from by rounding, so a few points on the boundary are allowed to disagree.
+static bool CheckShortReference()
+{
+    static const double References[][2] = {
+        {2.5, 0.5},  // already outside |c| = 2
+        {1.5, 0.0},  // escapes at Z_2
+        {-2.1, 0.0}, // escapes at Z_2 on the other side
+    };
+    const unsigned int Side = 64;
+    const int Iterations = 200;
+
+    vector<double> cx, cy;
+    for(unsigned int row = 0; row < Side; ++row)
+    {
+        for(unsigned int column = 0; column < Side; ++column)
+        {
+            cx.push_back(-2.25 + 3.0 * column / Side);
+            cy.push_back(-1.5 + 3.0 * row / Side);
+        }
+    }
+    unsigned int count = cx.size();
+    vector<int> expected(count);
+    EscapeStats stats;
+    EscapeTimeBatch(cx.data(), cy.data(), count, Iterations, expected.data(), stats);
+
+    bool ok = true;
+    for(const double* reference : References)
+    {
+        ReferenceOrbit orbit;
+        orbit.Compute(BigFixed(reference[0]), BigFixed(reference[1]), Iterations + 2);
+        vector<double> dcx(count), dcy(count);
+        for(unsigned int p = 0; p < count; ++p)
+        {
+            dcx[p] = cx[p] - reference[0];
+            dcy[p] = cy[p] - reference[1];
+        }
+        vector<int> escapedAt(count);
+        PerturbationBatch(orbit, reference[0], reference[1], dcx.data(), dcy.data(), count, Iterations, escapedAt.data(), stats);
+
+        unsigned int mismatches = 0;
+        for(unsigned int p = 0; p < count; ++p)
+            mismatches += escapedAt[p] != expected[p];
+        if(orbit.GetLength() != 2 || mismatches > count / 100)
+        {
+            fprintf(stderr, "short reference (%g, %g): orbit length %u, %u of %u pixels differ\n",
+                reference[0], reference[1], orbit.GetLength(), mismatches, count);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+// Every quadrant of this view previews as almost all one colour, so a progressive frame tries them
+// all and settles on the least uniform. That frame has to come out the same as a plain render of the
+// view it settled on, down to the pixels of the preview grid left over from the last quadrant tried.
+static bool CheckSettledPreview()
+{
+    static UBYTE progressiveImage[((Width + 7) / 8) * Height];
+    static UBYTE plainImage[((Width + 7) / 8) * Height];
+
+    MandelbrotSet progressive;
+    progressive.SetRender(progressiveImage);
+    MandelbrotSet::ViewState state = progressive.GetViewState();
+    state.x = BigFixed(0.45);
+    state.y = BigFixed(0.45);
+    state.w = 0.05;
+    state.h = 0.025;
+    state.zoomDirection = {1, 1};
+    state.zoomAlternatives = {{-1, 1}, {1, -1}, {-1, -1}};
+    progressive.SetViewState(state);
+    progressive.Render(Width, Height);
+
+    // The same budget as the progressive frame started with, not the one it adapted to afterwards
+    MandelbrotSet::ViewState settled = progressive.GetViewState();
+    settled.budgetScale = state.budgetScale;
+    MandelbrotSet plain;
+    plain.SetRender(plainImage);
+    plain.SetProgressive(false);
+    plain.SetViewState(settled);
+    plain.Render(Width, Height);
+
+    const uint16_t* expected = plain.GetIterationBuffer();
+    const uint16_t* actual = progressive.GetIterationBuffer();
+    unsigned int mismatches = 0;
+    for(unsigned int p = 0; p < (unsigned int)Width * Height; ++p)
+        mismatches += actual[p] != expected[p];
+    if(mismatches > 0 || memcmp(progressiveImage, plainImage, sizeof(plainImage)) != 0)
+    {
+        fprintf(stderr, "settled preview: %u of %u pixels differ from a plain render\n", mismatches, Width * Height);
+        return false;
+    }
+    return true;
+}
+
+// Runs body(out) in a child process, with out the real stdout and stdout itself silenced unless
+// log is set, since the renderer logs every frame there and would bury the results. Forking also
+// keeps the peak RSS of one run apart from the rest.
+template<typename Body>
+static bool RunInChild(bool log, Body body)
+{
+    fflush(stdout);
+    pid_t child = fork();
+    if(child == 0)
+    {
+        FILE* out = fdopen(dup(STDOUT_FILENO), "w");
+        if(out == NULL || (!log && freopen("/dev/null", "w", stdout) == NULL))
+        {
+            perror("renderbench output");
+            _exit(1);
+        }
+        bool ok = body(out);
+        fclose(out);
+        // _exit skips the stdio flush, which would lose the --log output when stdout is a pipe
+        fflush(stdout);
+        _exit(ok ? 0 : 1);
+    }
+
+    int status = 0;
+    return child >= 0 && waitpid(child, &status, 0) >= 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+int main(int argc, char* argv[])
+{
+    unsigned int repeats = 3;
+    uint32_t seed = 1;
+    const char* onlyView = NULL;
+    const char* onlyVariant = NULL;
+    bool log = false;
+    for(int i = 1; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "--repeats") == 0 && i + 1 < argc)
+            repeats = max(1, atoi(argv[++i]));
+        else if(strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            seed = strtoul(argv[++i], NULL, 10);
+        else if(strcmp(argv[i], "--view") == 0 && i + 1 < argc)
+            onlyView = argv[++i];
+        else if(strcmp(argv[i], "--variant") == 0 && i + 1 < argc)
+            onlyVariant = argv[++i];
+        else if(strcmp(argv[i], "--log") == 0)
+            log = true;
+        else
+        {
+            fprintf(stderr, "usage: %s [--repeats N] [--seed N] [--view NAME] [--variant NAME] [--log]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    int failures = 0;
+    if(!RunInChild(log, [](FILE*) { return CheckShortReference() & CheckSettledPreview(); }))
+    {
+        fprintf(stderr, "checks failed\n");
+        ++failures;
+    }
+    for(const BenchView& view : Views)
+    {
+        if(onlyView != NULL && strcmp(onlyView, view.name) != 0)
+            continue;
+        for(const BenchVariant& variant : Variants)
+        {
+            if(onlyVariant != NULL && strcmp(onlyVariant, variant.name) != 0)
+                continue;
+
+            if(!RunInChild(log, [&](FILE* out) { return RunPair(view, variant, repeats, seed, out); }))
+            {
+                fprintf(stderr, "%s/%s failed\n", view.name, variant.name);
+                ++failures;
+            }
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,169 @@
+#include "bigfixed.hpp"
+#include <cmath>
+
+using namespace std;
+
+BigFixed::BigFixed()
+{
+    negative = false;
+    limbs.assign(3, 0);
+}
+
+BigFixed::BigFixed(double value, unsigned int fractionLimbs)
+{
+    negative = false;
+    limbs.assign(fractionLimbs + 1, 0);
+    SetDouble(value);
+}
+
+void BigFixed::SetLimbs(bool negative, const vector<uint32_t>& limbs)
+{
+    this->negative = negative;
+    this->limbs = limbs;
+}
+
+void BigFixed::SetFractionLimbs(unsigned int fractionLimbs)
+{
+    unsigned int current = GetFractionLimbs();
+    if(fractionLimbs > current)
+    {
+        limbs.insert(limbs.begin(), fractionLimbs - current, 0);
+    }
+    else if(fractionLimbs < current)
+    {
+        limbs.erase(limbs.begin(), limbs.begin() + (current - fractionLimbs));
+    }
+}
+
+void BigFixed::SetDouble(double value)
+{
+    negative = value < 0;
+    double magnitude = fabs(value);
+
+    // Peel off 32 bits at a time; every step is exact in double arithmetic
+    double whole = floor(magnitude);
+    limbs.back() = (uint32_t)whole;
+    double fraction = magnitude - whole;
+    for(int i = (int)limbs.size() - 2; i >= 0; --i)
+    {
+        fraction *= 4294967296.0;
+        whole = floor(fraction);
+        limbs[i] = (uint32_t)whole;
+        fraction -= whole;
+    }
+}
+
+double BigFixed::ToDouble() const
+{
+    double value = 0;
+    double scale = ldexp(1.0, -32 * (int)GetFractionLimbs());
+    for(auto limb : limbs)
+    {
+        value += limb * scale;
+        scale *= 4294967296.0;
+    }
+    return negative ? -value : value;
+}
+
+int BigFixed::CompareMagnitude(const BigFixed& a, const BigFixed& b)
+{
+    for(int i = (int)a.limbs.size() - 1; i >= 0; --i)
+    {
+        if(a.limbs[i] != b.limbs[i])
+            return a.limbs[i] < b.limbs[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+void BigFixed::AddSigned(const BigFixed& a, const BigFixed& b, bool negateB, BigFixed& out)
+{
+    bool bNegative = b.negative != negateB;
+    out.limbs.resize(a.limbs.size());
+
+    if(a.negative == bNegative)
+    {
+        uint64_t carry = 0;
+        for(size_t i = 0; i < a.limbs.size(); ++i)
+        {
+            uint64_t sum = (uint64_t)a.limbs[i] + b.limbs[i] + carry;
+            out.limbs[i] = (uint32_t)sum;
+            carry = sum >> 32;
+        }
+        out.negative = a.negative;
+        return;
+    }
+
+    // Opposite signs: subtract the smaller magnitude from the larger
+    bool aLarger = CompareMagnitude(a, b) >= 0;
+    const BigFixed& larger = aLarger ? a : b;
+    const BigFixed& smaller = aLarger ? b : a;
+    bool resultNegative = aLarger ? a.negative : bNegative;
+
+    int64_t borrow = 0;
+    for(size_t i = 0; i < a.limbs.size(); ++i)
+    {
+        int64_t difference = (int64_t)larger.limbs[i] - smaller.limbs[i] - borrow;
+        borrow = difference < 0 ? 1 : 0;
+        out.limbs[i] = (uint32_t)(difference + (borrow << 32));
+    }
+    out.negative = resultNegative;
+}
+
+void BigFixed::Add(const BigFixed& a, const BigFixed& b, BigFixed& out)
+{
+    AddSigned(a, b, false, out);
+}
+
+void BigFixed::Sub(const BigFixed& a, const BigFixed& b, BigFixed& out)
+{
+    AddSigned(a, b, true, out);
+}
+
+void BigFixed::Mul(const BigFixed& a, const BigFixed& b, BigFixed& out)
+{
+    size_t n = a.limbs.size();
+    auto& product = out.product;
+    product.assign(2 * n, 0);
+
+    for(size_t i = 0; i < n; ++i)
+    {
+        uint64_t carry = 0;
+        for(size_t j = 0; j < n; ++j)
+        {
+            uint64_t t = (uint64_t)a.limbs[i] * b.limbs[j] + product[i + j] + carry;
+            product[i + j] = (uint32_t)t;
+            carry = t >> 32;
+        }
+        product[i + n] = carry;
+    }
+
+    // Drop the extra fraction limbs, the integer part never overflows for Mandelbrot sized values
+    bool resultNegative = a.negative != b.negative;
+    out.limbs.resize(n);
+    for(size_t i = 0; i < n; ++i)
+    {
+        out.limbs[i] = (uint32_t)product[i + n - 1];
+    }
+    out.negative = resultNegative;
+}
+
+BigFixed BigFixed::operator+(const BigFixed& other) const
+{
+    BigFixed result;
+    Add(*this, other, result);
+    return result;
+}
+
+BigFixed BigFixed::operator-(const BigFixed& other) const
+{
+    BigFixed result;
+    Sub(*this, other, result);
+    return result;
+}
+
+BigFixed BigFixed::operator*(const BigFixed& other) const
+{
+    BigFixed result;
+    Mul(*this, other, result);
+    return result;
+}
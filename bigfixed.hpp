@@ -0,0 +1,49 @@
+#ifndef BIGFIXED_HPP
+#define BIGFIXED_HPP
+
+#include <cstdint>
+#include <vector>
+
+// Signed fixed point number with one 32 bit integer limb and a configurable number of
+// 32 bit fraction limbs. Used for the view centre and the reference orbit of deep zooms,
+// where the coordinates need more bits than a double has.
+// Operands of one operation must have the same precision; results take that precision.
+class BigFixed
+{
+public:
+    BigFixed();
+    explicit BigFixed(double value, unsigned int fractionLimbs = 2);
+
+    unsigned int GetFractionLimbs() const { return limbs.size() - 1; };
+    // Extends with zero bits or truncates the least significant ones
+    void SetFractionLimbs(unsigned int fractionLimbs);
+
+    double ToDouble() const;
+    void SetDouble(double value);
+    // Exact contents, for saving a value and restoring it bit for bit. limbs is the little endian
+    // magnitude with the integer part last, so its size is one more than the fraction limbs.
+    bool IsNegative() const { return negative; };
+    const std::vector<uint32_t>& GetLimbs() const { return limbs; };
+    void SetLimbs(bool negative, const std::vector<uint32_t>& limbs);
+
+    // out may alias either operand
+    static void Add(const BigFixed& a, const BigFixed& b, BigFixed& out);
+    static void Sub(const BigFixed& a, const BigFixed& b, BigFixed& out);
+    static void Mul(const BigFixed& a, const BigFixed& b, BigFixed& out);
+
+    BigFixed operator+(const BigFixed& other) const;
+    BigFixed operator-(const BigFixed& other) const;
+    BigFixed operator*(const BigFixed& other) const;
+
+private:
+    static void AddSigned(const BigFixed& a, const BigFixed& b, bool negateB, BigFixed& out);
+    static int CompareMagnitude(const BigFixed& a, const BigFixed& b);
+
+    bool negative;
+    // Little endian magnitude, the last limb is the integer part
+    std::vector<uint32_t> limbs;
+    // Scratch space for Mul so the reference orbit loop doesn't allocate
+    std::vector<uint64_t> product;
+};
+
+#endif
@@ -0,0 +1,185 @@
+#include "checkpoint.hpp"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+static const char CheckpointMagic[8] = {'P', 'A', 'F', 'S', 'T', 'A', 'T', '1'};
+// Deeper than any zoom path gets before it starts over
+static const uint32_t MaxCheckpointLimbs = 64;
+
+template<typename T>
+static void Put(vector<UBYTE>& out, const T& value)
+{
+    const UBYTE* bytes = (const UBYTE*)&value;
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+template<typename T>
+static bool Get(const vector<UBYTE>& in, size_t& offset, T& value)
+{
+    if(offset + sizeof(T) > in.size())
+        return false;
+    memcpy(&value, in.data() + offset, sizeof(T));
+    offset += sizeof(T);
+    return true;
+}
+
+static void PutBigFixed(vector<UBYTE>& out, const BigFixed& value)
+{
+    Put(out, (uint32_t)value.IsNegative());
+    Put(out, (uint32_t)value.GetLimbs().size());
+    for(uint32_t limb : value.GetLimbs())
+    {
+        Put(out, limb);
+    }
+}
+
+static bool GetBigFixed(const vector<UBYTE>& in, size_t& offset, BigFixed& value)
+{
+    uint32_t negative;
+    uint32_t count;
+    if(!Get(in, offset, negative) || !Get(in, offset, count) || count == 0 || count > MaxCheckpointLimbs)
+        return false;
+    vector<uint32_t> limbs(count);
+    for(uint32_t& limb : limbs)
+    {
+        if(!Get(in, offset, limb))
+            return false;
+    }
+    value.SetLimbs(negative != 0, limbs);
+    return true;
+}
+
+static uint32_t Checksum(const UBYTE* data, size_t size)
+{
+    uint32_t hash = 2166136261u;
+    for(size_t i = 0; i < size; ++i)
+    {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+bool SaveCheckpoint(const char* path, const Checkpoint& checkpoint)
+{
+    // A couple of hundred bytes once per frame, so the SD card hardly notices
+    const MandelbrotSet::ViewState& view = checkpoint.view;
+    vector<UBYTE> data(CheckpointMagic, CheckpointMagic + sizeof(CheckpointMagic));
+    PutBigFixed(data, view.x);
+    PutBigFixed(data, view.y);
+    Put(data, view.w);
+    Put(data, view.h);
+    Put(data, (uint32_t)view.zoomLevel);
+    Put(data, view.zoomPath);
+    Put(data, (int32_t)view.zoomDirection.first);
+    Put(data, (int32_t)view.zoomDirection.second);
+    Put(data, (uint32_t)view.zoomAlternatives.size());
+    for(auto& alternative : view.zoomAlternatives)
+    {
+        Put(data, (int32_t)alternative.first);
+        Put(data, (int32_t)alternative.second);
+    }
+    Put(data, view.budgetScale);
+    Put(data, view.randomSeed);
+    Put(data, view.randomDraws);
+    Put(data, (uint32_t)checkpoint.numberOfZooms);
+    Put(data, checkpoint.shownAt);
+    Put(data, Checksum(data.data(), data.size()));
+
+    string temporary = string(path) + ".tmp";
+    int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0)
+    {
+        perror("Checkpoint open");
+        return false;
+    }
+    bool written = write(fd, data.data(), data.size()) == (ssize_t)data.size() && fsync(fd) == 0;
+    if(close(fd) != 0 || !written)
+    {
+        perror("Checkpoint write");
+        unlink(temporary.c_str());
+        return false;
+    }
+    if(rename(temporary.c_str(), path) != 0)
+    {
+        perror("Checkpoint rename");
+        unlink(temporary.c_str());
+        return false;
+    }
+
+    // The rename itself only survives a power cut once the directory is synced
+    string directory(path);
+    size_t slash = directory.rfind('/');
+    directory = slash == string::npos ? "." : (slash == 0 ? "/" : directory.substr(0, slash));
+    int directoryFd = open(directory.c_str(), O_RDONLY);
+    if(directoryFd >= 0)
+    {
+        fsync(directoryFd);
+        close(directoryFd);
+    }
+    return true;
+}
+
+bool LoadCheckpoint(const char* path, Checkpoint& checkpoint)
+{
+    FILE* file = fopen(path, "rb");
+    if(file == NULL)
+        return false;
+    vector<UBYTE> data;
+    UBYTE chunk[512];
+    size_t read;
+    while((read = fread(chunk, 1, sizeof(chunk), file)) > 0)
+    {
+        data.insert(data.end(), chunk, chunk + read);
+    }
+    fclose(file);
+
+    uint32_t checksum = 0;
+    size_t end = data.size() >= sizeof(CheckpointMagic) + sizeof(checksum) ? data.size() - sizeof(checksum) : 0;
+    if(end > 0)
+    {
+        memcpy(&checksum, data.data() + end, sizeof(checksum));
+    }
+    if(end == 0 || memcmp(data.data(), CheckpointMagic, sizeof(CheckpointMagic)) != 0 || checksum != Checksum(data.data(), end))
+    {
+        printf("Checkpoint %s is damaged, starting from the whole set\r\n", path);
+        return false;
+    }
+    data.resize(end);
+
+    MandelbrotSet::ViewState& view = checkpoint.view;
+    size_t offset = sizeof(CheckpointMagic);
+    uint32_t zoomLevel;
+    int32_t direction[2];
+    uint32_t alternatives;
+    uint32_t numberOfZooms;
+    bool complete = GetBigFixed(data, offset, view.x) && GetBigFixed(data, offset, view.y)
+        && Get(data, offset, view.w) && Get(data, offset, view.h)
+        && Get(data, offset, zoomLevel) && Get(data, offset, view.zoomPath)
+        && Get(data, offset, direction[0]) && Get(data, offset, direction[1])
+        && Get(data, offset, alternatives) && alternatives <= 3;
+    view.zoomAlternatives.clear();
+    for(uint32_t a = 0; complete && a < alternatives; ++a)
+    {
+        int32_t alternative[2] = {0, 0};
+        complete = Get(data, offset, alternative[0]) && Get(data, offset, alternative[1]);
+        view.zoomAlternatives.emplace_back(alternative[0], alternative[1]);
+    }
+    complete = complete && Get(data, offset, view.budgetScale) && Get(data, offset, view.randomSeed)
+        && Get(data, offset, view.randomDraws) && Get(data, offset, numberOfZooms)
+        && Get(data, offset, checkpoint.shownAt) && offset == data.size();
+    if(!complete)
+    {
+        printf("Checkpoint %s is damaged, starting from the whole set\r\n", path);
+        return false;
+    }
+    view.zoomLevel = zoomLevel;
+    view.zoomDirection = make_pair(direction[0], direction[1]);
+    checkpoint.numberOfZooms = numberOfZooms;
+    return true;
+}
@@ -0,0 +1,23 @@
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include "mandelbrot.hpp"
+#include <cstdint>
+
+// Where the zoom path had got to, saved once per frame so a restart after a power cut carries on
+// from the image still on the panel instead of going back to the whole set
+struct Checkpoint
+{
+    // The view rendered next, already zoomed into
+    MandelbrotSet::ViewState view;
+    unsigned int numberOfZooms;
+    // Wall clock time in seconds the image on the panel went up
+    int64_t shownAt;
+};
+
+// Writes a temporary file next to path, syncs it and renames it over path, so the file on disk is
+// always either the old checkpoint or the new one in full. Both return false on failure.
+bool SaveCheckpoint(const char* path, const Checkpoint& checkpoint);
+bool LoadCheckpoint(const char* path, Checkpoint& checkpoint);
+
+#endif
@@ -0,0 +1,59 @@
+#include "doubledouble.hpp"
+#include <algorithm>
+
+DoubleDouble ToDoubleDouble(const BigFixed& value)
+{
+    double hi = value.ToDouble();
+    double lo = (value - BigFixed(hi, value.GetFractionLimbs())).ToDouble();
+    return QuickTwoSum(hi, lo);
+}
+
+void DoubleDoubleBatch(const DoubleDouble* cx, const DoubleDouble* cy, unsigned int count, int iterations,
+    int* escapedAt, EscapeStats& stats)
+{
+    const DoubleDouble two = {2.0, 0.0};
+
+    for(unsigned int p = 0; p < count; ++p)
+    {
+        escapedAt[p] = iterations;
+
+        if(IsInCardioidOrBulb(cx[p].hi, cy[p].hi))
+        {
+            stats.skippedInterior += std::max(iterations, 0);
+            continue;
+        }
+
+        DoubleDouble zx = cx[p];
+        DoubleDouble zy = cy[p];
+        DoubleDouble savedX = zx;
+        DoubleDouble savedY = zy;
+        int nextSave = FirstPeriodCheckpoint;
+
+        for(int i = 0; i < iterations; ++i)
+        {
+            DoubleDouble zxOld = zx;
+            zx = zx * zx - zy * zy + cx[p];
+            zy = two * zxOld * zy + cy[p];
+            ++stats.iterations;
+
+            // The bailout doesn't need the low parts
+            if(zx.hi * zx.hi + zy.hi * zy.hi > 4)
+            {
+                escapedAt[p] = i;
+                break;
+            }
+
+            if(zx.hi == savedX.hi && zx.lo == savedX.lo && zy.hi == savedY.hi && zy.lo == savedY.lo)
+            {
+                stats.skippedPeriodic += iterations - (i + 1);
+                break;
+            }
+            if(i + 1 == nextSave)
+            {
+                savedX = zx;
+                savedY = zy;
+                nextSave *= 2;
+            }
+        }
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef DOUBLEDOUBLE_HPP
+#define DOUBLEDOUBLE_HPP
+
+#include "bigfixed.hpp"
+#include "escapetime.hpp"
+#include <cmath>
+
+// Unevaluated sum of two doubles, giving about 106 bits of mantissa.
+// The error free transforms rely on the build not contracting into FMAs (-ffp-contract=off)
+// unless it uses fma itself where the hardware has it.
+struct DoubleDouble
+{
+    double hi;
+    double lo;
+};
+
+inline DoubleDouble QuickTwoSum(double a, double b)
+{
+    double s = a + b;
+    return {s, b - (s - a)};
+}
+
+inline DoubleDouble TwoSum(double a, double b)
+{
+    double s = a + b;
+    double bb = s - a;
+    return {s, (a - (s - bb)) + (b - bb)};
+}
+
+inline DoubleDouble TwoProd(double a, double b)
+{
+    double p = a * b;
+#ifdef FP_FAST_FMA
+    return {p, std::fma(a, b, -p)};
+#else
+    // Dekker's split, for cores without a fused multiply-add (e.g. the Pi Zero)
+    const double split = 134217729.0; // 2^27 + 1
+    double ta = split * a;
+    double aHi = ta - (ta - a);
+    double aLo = a - aHi;
+    double tb = split * b;
+    double bHi = tb - (tb - b);
+    double bLo = b - bHi;
+    return {p, ((aHi * bHi - p) + aHi * bLo + aLo * bHi) + aLo * bLo};
+#endif
+}
+
+inline DoubleDouble operator+(const DoubleDouble& a, const DoubleDouble& b)
+{
+    DoubleDouble s = TwoSum(a.hi, b.hi);
+    DoubleDouble t = TwoSum(a.lo, b.lo);
+    s.lo += t.hi;
+    s = QuickTwoSum(s.hi, s.lo);
+    s.lo += t.lo;
+    return QuickTwoSum(s.hi, s.lo);
+}
+
+inline DoubleDouble operator-(const DoubleDouble& a)
+{
+    return {-a.hi, -a.lo};
+}
+
+inline DoubleDouble operator-(const DoubleDouble& a, const DoubleDouble& b)
+{
+    return a + (-b);
+}
+
+inline DoubleDouble operator*(const DoubleDouble& a, const DoubleDouble& b)
+{
+    DoubleDouble p = TwoProd(a.hi, b.hi);
+    p.lo += a.hi * b.lo + a.lo * b.hi;
+    return QuickTwoSum(p.hi, p.lo);
+}
+
+// Nearest double-double to a BigFixed
+DoubleDouble ToDoubleDouble(const BigFixed& value);
+
+// Brute force escape time in double-double for views too deep for doubles but not yet deep
+// enough to need perturbation. Same escapedAt convention as EscapeTimeBatch.
+void DoubleDoubleBatch(const DoubleDouble* cx, const DoubleDouble* cy, unsigned int count, int iterations,
+    int* escapedAt, EscapeStats& stats);
+
+#endif
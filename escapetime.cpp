@@ -0,0 +1,271 @@
+#include "escapetime.hpp"
+#include <algorithm>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+
+#if defined(__AVX2__)
+struct Lanes
+{
+    typedef __m256d Reg;
+    static constexpr int Width = 4;
+    static const char* Name() { return "AVX2"; }
+    static Reg Load(const double* p) { return _mm256_loadu_pd(p); }
+    static void Store(double* p, Reg r) { _mm256_storeu_pd(p, r); }
+    static Reg Set(double v) { return _mm256_set1_pd(v); }
+    static Reg Add(Reg a, Reg b) { return _mm256_add_pd(a, b); }
+    static Reg Sub(Reg a, Reg b) { return _mm256_sub_pd(a, b); }
+    static Reg Mul(Reg a, Reg b) { return _mm256_mul_pd(a, b); }
+    static unsigned int Greater(Reg a, Reg b) { return _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_GT_OQ)); }
+    static unsigned int Equal(Reg a, Reg b) { return _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_EQ_OQ)); }
+};
+#elif defined(__SSE2__)
+struct Lanes
+{
+    typedef __m128d Reg;
+    static constexpr int Width = 2;
+    static const char* Name() { return "SSE2"; }
+    static Reg Load(const double* p) { return _mm_loadu_pd(p); }
+    static void Store(double* p, Reg r) { _mm_storeu_pd(p, r); }
+    static Reg Set(double v) { return _mm_set1_pd(v); }
+    static Reg Add(Reg a, Reg b) { return _mm_add_pd(a, b); }
+    static Reg Sub(Reg a, Reg b) { return _mm_sub_pd(a, b); }
+    static Reg Mul(Reg a, Reg b) { return _mm_mul_pd(a, b); }
+    static unsigned int Greater(Reg a, Reg b) { return _mm_movemask_pd(_mm_cmpgt_pd(a, b)); }
+    static unsigned int Equal(Reg a, Reg b) { return _mm_movemask_pd(_mm_cmpeq_pd(a, b)); }
+};
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+struct Lanes
+{
+    typedef float64x2_t Reg;
+    static constexpr int Width = 2;
+    static const char* Name() { return "NEON"; }
+    static Reg Load(const double* p) { return vld1q_f64(p); }
+    static void Store(double* p, Reg r) { vst1q_f64(p, r); }
+    static Reg Set(double v) { return vdupq_n_f64(v); }
+    static Reg Add(Reg a, Reg b) { return vaddq_f64(a, b); }
+    static Reg Sub(Reg a, Reg b) { return vsubq_f64(a, b); }
+    static Reg Mul(Reg a, Reg b) { return vmulq_f64(a, b); }
+    static unsigned int Greater(Reg a, Reg b)
+    {
+        uint64x2_t m = vcgtq_f64(a, b);
+        return (vgetq_lane_u64(m, 0) & 1) | ((vgetq_lane_u64(m, 1) & 1) << 1);
+    }
+    static unsigned int Equal(Reg a, Reg b)
+    {
+        uint64x2_t m = vceqq_f64(a, b);
+        return (vgetq_lane_u64(m, 0) & 1) | ((vgetq_lane_u64(m, 1) & 1) << 1);
+    }
+};
+#else
+// No double precision vector unit (e.g. 32-bit ARM), still worth interleaving lanes for the pipeline
+struct Lanes
+{
+    typedef double Reg;
+    static constexpr int Width = 1;
+    static const char* Name() { return "scalar"; }
+    static Reg Load(const double* p) { return *p; }
+    static void Store(double* p, Reg r) { *p = r; }
+    static Reg Set(double v) { return v; }
+    static Reg Add(Reg a, Reg b) { return a + b; }
+    static Reg Sub(Reg a, Reg b) { return a - b; }
+    static Reg Mul(Reg a, Reg b) { return a * b; }
+    static unsigned int Greater(Reg a, Reg b) { return a > b ? 1 : 0; }
+    static unsigned int Equal(Reg a, Reg b) { return a == b ? 1 : 0; }
+};
+#endif
+
+// Registers iterated together; two hide most of the multiply latency
+constexpr int Unroll = 2;
+constexpr int GroupSize = Unroll * Lanes::Width;
+constexpr int PeriodCheckStride = 4;
+
+struct LaneGroup
+{
+    double cx[GroupSize];
+    double cy[GroupSize];
+    double zx[GroupSize];
+    double zy[GroupSize];
+    double savedX[GroupSize];
+    double savedY[GroupSize];
+    int count[GroupSize];
+    int nextSave[GroupSize];
+    unsigned int pixel[GroupSize];
+    bool active[GroupSize];
+};
+
+// Loads the next queued point into a lane, or parks the lane at the origin where it can never escape.
+// Points in the cardioid or bulb are answered straight from the queue.
+bool Refill(LaneGroup& g, int lane, const double* cx, const double* cy, OrbitState* orbits, unsigned int& next,
+    unsigned int count, int iterations, int* escapedAt, EscapeStats& stats)
+{
+    while(next < count && IsInCardioidOrBulb(cx[next], cy[next]))
+    {
+        escapedAt[next] = iterations;
+        stats.skippedInterior += iterations;
+        if(orbits)
+            orbits[next].count = -1;
+        ++next;
+    }
+
+    if(next >= count)
+    {
+        g.cx[lane] = g.cy[lane] = g.zx[lane] = g.zy[lane] = 0;
+        g.savedX[lane] = g.savedY[lane] = 1;
+        g.active[lane] = false;
+        return false;
+    }
+
+    g.pixel[lane] = next;
+    g.cx[lane] = g.zx[lane] = g.savedX[lane] = cx[next];
+    g.cy[lane] = g.zy[lane] = g.savedY[lane] = cy[next];
+    g.count[lane] = 0;
+    g.nextSave[lane] = FirstPeriodCheckpoint;
+    if(orbits && orbits[next].count > 0)
+    {
+        // Cycle detection starts over from the resumed point
+        g.zx[lane] = g.savedX[lane] = orbits[next].zx;
+        g.zy[lane] = g.savedY[lane] = orbits[next].zy;
+        g.count[lane] = orbits[next].count;
+        while(g.nextSave[lane] <= g.count[lane])
+        {
+            g.nextSave[lane] *= 2;
+        }
+    }
+    g.active[lane] = true;
+    ++next;
+    return true;
+}
+
+}
+
+void EscapeTimeBatch(const double* cx, const double* cy, unsigned int count, int iterations, int* escapedAt, EscapeStats& stats,
+    OrbitState* orbits)
+{
+    if(iterations <= 0)
+    {
+        fill(escapedAt, escapedAt + count, iterations);
+        return;
+    }
+
+    LaneGroup g;
+    unsigned int next = 0;
+    int activeLanes = 0;
+    for(int lane = 0; lane < GroupSize; ++lane)
+    {
+        activeLanes += Refill(g, lane, cx, cy, orbits, next, count, iterations, escapedAt, stats);
+    }
+
+    const Lanes::Reg two = Lanes::Set(2.0);
+    const Lanes::Reg four = Lanes::Set(4.0);
+
+    while(activeLanes > 0)
+    {
+        // Run until the first lane escapes, repeats, reaches the iteration limit or is due a new checkpoint
+        int steps = iterations;
+        for(int lane = 0; lane < GroupSize; ++lane)
+        {
+            if(g.active[lane])
+                steps = min(steps, min(iterations, g.nextSave[lane]) - g.count[lane]);
+        }
+
+        Lanes::Reg rcx[Unroll], rcy[Unroll], rzx[Unroll], rzy[Unroll], rsx[Unroll], rsy[Unroll];
+        for(int u = 0; u < Unroll; ++u)
+        {
+            rcx[u] = Lanes::Load(g.cx + u * Lanes::Width);
+            rcy[u] = Lanes::Load(g.cy + u * Lanes::Width);
+            rzx[u] = Lanes::Load(g.zx + u * Lanes::Width);
+            rzy[u] = Lanes::Load(g.zy + u * Lanes::Width);
+            rsx[u] = Lanes::Load(g.savedX + u * Lanes::Width);
+            rsy[u] = Lanes::Load(g.savedY + u * Lanes::Width);
+        }
+
+        // Same operation order as GetEscapeIteration so every lane rounds identically.
+        // Escapes are checked every step to get the exact iteration; repeats only need to be
+        // caught eventually (a periodic orbit is bounded either way), so those are checked every
+        // PeriodCheckStride steps to keep the comparisons out of most of the loop.
+        unsigned int escaped = 0;
+        unsigned int periodic = 0;
+        int done = 0;
+        while(done < steps && (escaped | periodic) == 0)
+        {
+            for(int u = 0; u < Unroll; ++u)
+            {
+                Lanes::Reg zxOld = rzx[u];
+                rzx[u] = Lanes::Add(Lanes::Sub(Lanes::Mul(rzx[u], rzx[u]), Lanes::Mul(rzy[u], rzy[u])), rcx[u]);
+                rzy[u] = Lanes::Add(Lanes::Mul(Lanes::Mul(two, zxOld), rzy[u]), rcy[u]);
+                Lanes::Reg sumSquared = Lanes::Add(Lanes::Mul(rzx[u], rzx[u]), Lanes::Mul(rzy[u], rzy[u]));
+                escaped |= Lanes::Greater(sumSquared, four) << (u * Lanes::Width);
+            }
+            ++done;
+
+            if(done % PeriodCheckStride == 0)
+            {
+                for(int u = 0; u < Unroll; ++u)
+                {
+                    periodic |= (Lanes::Equal(rzx[u], rsx[u]) & Lanes::Equal(rzy[u], rsy[u])) << (u * Lanes::Width);
+                }
+                periodic &= ~escaped;
+            }
+        }
+
+        for(int u = 0; u < Unroll; ++u)
+        {
+            Lanes::Store(g.zx + u * Lanes::Width, rzx[u]);
+            Lanes::Store(g.zy + u * Lanes::Width, rzy[u]);
+        }
+
+        // Retire finished lanes and refill them from the queue
+        for(int lane = 0; lane < GroupSize; ++lane)
+        {
+            if(!g.active[lane])
+                continue;
+
+            g.count[lane] += done;
+            stats.iterations += done;
+            if(escaped & (1u << lane))
+            {
+                escapedAt[g.pixel[lane]] = g.count[lane] - 1;
+            }
+            else if(periodic & (1u << lane))
+            {
+                escapedAt[g.pixel[lane]] = iterations;
+                stats.skippedPeriodic += iterations - g.count[lane];
+                if(orbits)
+                    orbits[g.pixel[lane]].count = -1;
+            }
+            else if(g.count[lane] >= iterations)
+            {
+                escapedAt[g.pixel[lane]] = iterations;
+                if(orbits)
+                    orbits[g.pixel[lane]] = {g.zx[lane], g.zy[lane], g.count[lane]};
+            }
+            else
+            {
+                if(g.count[lane] == g.nextSave[lane])
+                {
+                    g.savedX[lane] = g.zx[lane];
+                    g.savedY[lane] = g.zy[lane];
+                    g.nextSave[lane] *= 2;
+                }
+                continue;
+            }
+
+            if(!Refill(g, lane, cx, cy, orbits, next, count, iterations, escapedAt, stats))
+                --activeLanes;
+        }
+    }
+}
+
+const char* EscapeTimeIsa()
+{
+    return Lanes::Name();
+}
@@ -0,0 +1,64 @@
+#ifndef ESCAPETIME_HPP
+#define ESCAPETIME_HPP
+
+// Work counters for one frame, summed over every pixel that was evaluated
+struct EscapeStats
+{
+    unsigned long long iterations = 0;       // z = z^2 + c steps actually executed
+    unsigned long long skippedInterior = 0;  // steps saved by the cardioid and period-2 bulb tests
+    unsigned long long skippedPeriodic = 0;  // steps saved by stopping once an orbit repeated exactly
+    unsigned long long rebases = 0;          // perturbation pixels moved back onto the start of the reference orbit
+    unsigned long long pixels = 0;           // pixels handed to a kernel, as opposed to inferred from their neighbours
+    unsigned long long reusedPixels = 0;     // pixels answered or resumed from the previous frame
+    unsigned long long reusedIterations = 0; // steps the previous frame had already run for those pixels
+
+    void Add(const EscapeStats& other)
+    {
+        iterations += other.iterations;
+        skippedInterior += other.skippedInterior;
+        skippedPeriodic += other.skippedPeriodic;
+        rebases += other.rebases;
+        pixels += other.pixels;
+        reusedPixels += other.reusedPixels;
+        reusedIterations += other.reusedIterations;
+    }
+};
+
+// First iteration count at which an orbit is saved for cycle detection. Starting late keeps
+// quickly escaping points from paying for checkpoints; later ones double from here.
+constexpr int FirstPeriodCheckpoint = 32;
+
+// Closed form membership of the main cardioid and the period-2 bulb, which never escape
+inline bool IsInCardioidOrBulb(double x, double y)
+{
+    double yy = y * y;
+    double q = (x - 0.25) * (x - 0.25) + yy;
+    if(q * (q + (x - 0.25)) <= 0.25 * yy)
+        return true;
+    return (x + 1.0) * (x + 1.0) + yy <= 0.0625;
+}
+
+// Where an orbit stopped, so a later frame with a bigger budget can carry on from there
+struct OrbitState
+{
+    double zx;
+    double zy;
+    int count;  // iterations done to reach z, 0 for a point not iterated yet, or -1 if it provably never escapes
+};
+
+// Vectorised escape time kernel.
+// Iterates z = z^2 + c from z = c for `count` points and writes to escapedAt[i] the
+// iteration on which point i escaped, or `iterations` if it stayed bounded.
+// Points inside the cardioid or bulb are not iterated at all, and an orbit that lands exactly
+// on its last power-of-two checkpoint (Brent) is periodic and stops early as bounded.
+// Results match MandelbrotSet::GetEscapeIteration bit for bit as long as the build does
+// not contract the arithmetic into fused multiply-adds (-ffp-contract=off).
+// With orbits, points whose count is above 0 resume from the stored z instead of starting over,
+// and every point that doesn't escape leaves its final state there.
+void EscapeTimeBatch(const double* cx, const double* cy, unsigned int count, int iterations, int* escapedAt, EscapeStats& stats,
+    OrbitState* orbits = nullptr);
+
+// Name of the instruction set EscapeTimeBatch was built for
+const char* EscapeTimeIsa();
+
+#endif
@@ -82,9 +82,375 @@
 #include <stdlib.h>
 #include <string.h> //memset()
 #include <math.h>
+#include <pthread.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
 
 PAINT Paint;
 
+/******************************************************************************
+function: Pixel writers
+info:
+    Rotating and then mirroring only ever swaps X and Y and flips either of
+    them, so the sixteen rotate and mirror combinations come down to eight
+    orientations. Each orientation gets a writer per pixel format, and
+    Paint_SelectPixelWriter picks one whenever the rotation, the mirroring or
+    the scale changes instead of Paint_SetPixel working it out for every pixel.
+    The flips wrap around in UWORD just like the rotate and mirror steps did.
+******************************************************************************/
+#define PAINT_STORE_SCALE2(paint, X, Y, Color) { \
+    UDOUBLE Addr = X / 8 + Y * paint->WidthByte; \
+    UBYTE Rdata = paint->Image[Addr]; \
+    if(Color == BLACK) \
+        paint->Image[Addr] = Rdata & ~(0x80 >> (X % 8)); \
+    else \
+        paint->Image[Addr] = Rdata | (0x80 >> (X % 8)); \
+}
+
+#define PAINT_STORE_SCALE4(paint, X, Y, Color) { \
+    UDOUBLE Addr = X / 4 + Y * paint->WidthByte; \
+    Color = Color % 4; \
+    UBYTE Rdata = paint->Image[Addr]; \
+    Rdata = Rdata & (~(0xC0 >> ((X % 4)*2))); \
+    paint->Image[Addr] = Rdata | ((Color << 6) >> ((X % 4)*2)); \
+}
+
+#define PAINT_STORE_SCALE16(paint, X, Y, Color) { \
+    UDOUBLE Addr = X / 2 + Y * paint->WidthByte; \
+    UBYTE Rdata = paint->Image[Addr]; \
+    Rdata = Rdata & (~(0xF0 >> ((X % 2)*4))); \
+    paint->Image[Addr] = Rdata | ((Color << 4) >> ((X % 2)*4)); \
+}
+
+#define PAINT_PIXEL_WRITER(Name, Swap, FlipX, FlipY, Store) \
+static void Name(PAINT *paint, UWORD Xpoint, UWORD Ypoint, UWORD Color) \
+{ \
+    if(Xpoint > paint->Width || Ypoint > paint->Height){ \
+        Debug("Exceeding display boundaries\r\n"); \
+        return; \
+    } \
+    UWORD X = (Swap)? Ypoint : Xpoint; \
+    UWORD Y = (Swap)? Xpoint : Ypoint; \
+    if(FlipX) \
+        X = paint->WidthMemory - X - 1; \
+    if(FlipY) \
+        Y = paint->HeightMemory - Y - 1; \
+    if(X > paint->WidthMemory || Y > paint->HeightMemory){ \
+        Debug("Exceeding display boundaries\r\n"); \
+        return; \
+    } \
+    Store(paint, X, Y, Color) \
+}
+
+#define PAINT_PIXEL_WRITERS(Name, Swap, FlipX, FlipY) \
+    PAINT_PIXEL_WRITER(Name##_Scale2, Swap, FlipX, FlipY, PAINT_STORE_SCALE2) \
+    PAINT_PIXEL_WRITER(Name##_Scale4, Swap, FlipX, FlipY, PAINT_STORE_SCALE4) \
+    PAINT_PIXEL_WRITER(Name##_Scale16, Swap, FlipX, FlipY, PAINT_STORE_SCALE16)
+
+PAINT_PIXEL_WRITERS(Paint_SetPixel_Straight, 0, 0, 0)
+PAINT_PIXEL_WRITERS(Paint_SetPixel_FlipY, 0, 0, 1)
+PAINT_PIXEL_WRITERS(Paint_SetPixel_FlipX, 0, 1, 0)
+PAINT_PIXEL_WRITERS(Paint_SetPixel_FlipXY, 0, 1, 1)
+PAINT_PIXEL_WRITERS(Paint_SetPixel_Swap, 1, 0, 0)
+PAINT_PIXEL_WRITERS(Paint_SetPixel_SwapFlipY, 1, 0, 1)
+PAINT_PIXEL_WRITERS(Paint_SetPixel_SwapFlipX, 1, 1, 0)
+PAINT_PIXEL_WRITERS(Paint_SetPixel_SwapFlipXY, 1, 1, 1)
+
+/* Rotations and scales the old per pixel switches had no case for wrote nothing */
+static void Paint_SetPixel_None(PAINT *paint, UWORD Xpoint, UWORD Ypoint, UWORD Color)
+{
+}
+
+static void Paint_SetPixel_Tracked(PAINT *paint, UWORD Xpoint, UWORD Ypoint, UWORD Color);
+
+/* Indexed by Paint_Orientation, then by Paint_Format */
+static void (* const Paint_PixelWriters[8][3])(PAINT *, UWORD, UWORD, UWORD) = {
+    {Paint_SetPixel_Straight_Scale2, Paint_SetPixel_Straight_Scale4, Paint_SetPixel_Straight_Scale16},
+    {Paint_SetPixel_FlipY_Scale2, Paint_SetPixel_FlipY_Scale4, Paint_SetPixel_FlipY_Scale16},
+    {Paint_SetPixel_FlipX_Scale2, Paint_SetPixel_FlipX_Scale4, Paint_SetPixel_FlipX_Scale16},
+    {Paint_SetPixel_FlipXY_Scale2, Paint_SetPixel_FlipXY_Scale4, Paint_SetPixel_FlipXY_Scale16},
+    {Paint_SetPixel_Swap_Scale2, Paint_SetPixel_Swap_Scale4, Paint_SetPixel_Swap_Scale16},
+    {Paint_SetPixel_SwapFlipY_Scale2, Paint_SetPixel_SwapFlipY_Scale4, Paint_SetPixel_SwapFlipY_Scale16},
+    {Paint_SetPixel_SwapFlipX_Scale2, Paint_SetPixel_SwapFlipX_Scale4, Paint_SetPixel_SwapFlipX_Scale16},
+    {Paint_SetPixel_SwapFlipXY_Scale2, Paint_SetPixel_SwapFlipXY_Scale4, Paint_SetPixel_SwapFlipXY_Scale16},
+};
+
+#define PAINT_FLIP_Y    0x01
+#define PAINT_FLIP_X    0x02
+#define PAINT_SWAP      0x04
+
+/* Swap and flips of the rotation and mirroring combined, -1 if either is unknown */
+static int Paint_Orientation(UWORD Rotate, UWORD Mirror)
+{
+    int Orientation;
+    switch(Rotate) {
+    case 0:
+        Orientation = 0;
+        break;
+    case 90:
+        Orientation = PAINT_SWAP | PAINT_FLIP_X;
+        break;
+    case 180:
+        Orientation = PAINT_FLIP_X | PAINT_FLIP_Y;
+        break;
+    case 270:
+        Orientation = PAINT_SWAP | PAINT_FLIP_Y;
+        break;
+    default:
+        return -1;
+    }
+
+    if(Mirror > MIRROR_ORIGIN)
+        return -1;
+    if(Mirror & MIRROR_HORIZONTAL)
+        Orientation ^= PAINT_FLIP_X;
+    if(Mirror & MIRROR_VERTICAL)
+        Orientation ^= PAINT_FLIP_Y;
+    return Orientation;
+}
+
+/* 0 for 1 bit, 1 for 2 bit and 2 for 4 bit pixels, -1 if the scale is unknown */
+static int Paint_Format(const PAINT *paint)
+{
+    if(paint->Scale == 2)
+        return 0;
+    else if(paint->Scale == 4)
+        return 1;
+    else if(paint->Scale == 7 || paint->Scale == 16)
+        return 2;
+    return -1;
+}
+
+static void Paint_SelectPixelWriter(PAINT *paint)
+{
+    int Orientation = Paint_Orientation(paint->Rotate, paint->Mirror);
+    int Format = Paint_Format(paint);
+    if(Orientation < 0 || Format < 0)
+        paint->WritePixel = Paint_SetPixel_None;
+    else
+        paint->WritePixel = Paint_PixelWriters[Orientation][Format];
+    //Only a PAINT that tracks dirty rectangles pays for it on every pixel
+    paint->SetPixel = paint->TrackDirty? Paint_SetPixel_Tracked : paint->WritePixel;
+    //The dirty hint is in image coordinates, which may have just turned
+    memset(&paint->DirtyHint, 0, sizeof(PAINT_RECT));
+}
+
+/******************************************************************************
+function: Dirty rectangles
+info:
+    While tracking is on, every primitive adds the box it may have drawn in
+    to the PAINT's list of dirty rectangles, in memory coordinates with X
+    widened to whole bytes, so a panel can be sent only what changed. A box that touches or overlaps a
+    rectangle already listed is merged into it, and once the list is full a
+    new box is merged into whichever rectangle grows least. Boxes are
+    clipped to the image; the writes Paint_SetPixel lets through one past
+    the right and bottom edges aren't tracked.
+******************************************************************************/
+static UBYTE Paint_RectTouches(const PAINT_RECT *a, const PAINT_RECT *b)
+{
+    return a->Xstart <= b->Xend && b->Xstart <= a->Xend && a->Ystart <= b->Yend && b->Ystart <= a->Yend;
+}
+
+static void Paint_RectUnion(PAINT_RECT *a, const PAINT_RECT *b)
+{
+    if (b->Xstart < a->Xstart) a->Xstart = b->Xstart;
+    if (b->Ystart < a->Ystart) a->Ystart = b->Ystart;
+    if (b->Xend > a->Xend) a->Xend = b->Xend;
+    if (b->Yend > a->Yend) a->Yend = b->Yend;
+}
+
+static UDOUBLE Paint_RectArea(const PAINT_RECT *a)
+{
+    return (UDOUBLE)(a->Xend - a->Xstart) * (a->Yend - a->Ystart);
+}
+
+/* Returns the rectangle that covers the box now */
+static const PAINT_RECT *Paint_AddDirty(PAINT *paint, PAINT_RECT Rect)
+{
+    UBYTE i;
+    for (i = 0; i < paint->DirtyCount; i++) {
+        const PAINT_RECT *Dirty = &paint->Dirty[i];
+        if (Dirty->Xstart <= Rect.Xstart && Dirty->Ystart <= Rect.Ystart &&
+            Rect.Xend <= Dirty->Xend && Rect.Yend <= Dirty->Yend)
+            return Dirty;
+    }
+
+    for (;;) {
+        //A merge can make the box reach rectangles it didn't before
+        for (i = 0; i < paint->DirtyCount; i++) {
+            if (Paint_RectTouches(&paint->Dirty[i], &Rect))
+                break;
+        }
+        if (i == paint->DirtyCount) {
+            if (paint->DirtyCount < PAINT_DIRTY_MAX)
+                break;
+            UDOUBLE Growth, Least = 0xFFFFFFFF;
+            for (UBYTE j = 0; j < paint->DirtyCount; j++) {
+                PAINT_RECT Merged = paint->Dirty[j];
+                Paint_RectUnion(&Merged, &Rect);
+                Growth = Paint_RectArea(&Merged) - Paint_RectArea(&paint->Dirty[j]);
+                if (Growth < Least) {
+                    Least = Growth;
+                    i = j;
+                }
+            }
+        }
+        Paint_RectUnion(&Rect, &paint->Dirty[i]);
+        paint->Dirty[i] = paint->Dirty[--paint->DirtyCount];
+    }
+    paint->Dirty[paint->DirtyCount] = Rect;
+    return &paint->Dirty[paint->DirtyCount++];
+}
+
+/*
+    Adds the box from (Xstart, Ystart) up to but not including (Xend, Yend).
+    The rectangle it went into is kept in image coordinates as well, so the
+    pixels and points that follow inside it are let through straight away.
+*/
+static void Paint_MarkDirtyBox(PAINT *paint, int Xstart, int Ystart, int Xend, int Yend)
+{
+    int Orientation = Paint_Orientation(paint->Rotate, paint->Mirror);
+    if (Orientation < 0)
+        return;
+    if (Xstart < 0)
+        Xstart = 0;
+    if (Ystart < 0)
+        Ystart = 0;
+    if (Xend > paint->Width)
+        Xend = paint->Width;
+    if (Yend > paint->Height)
+        Yend = paint->Height;
+    if (Xstart >= Xend || Ystart >= Yend)
+        return;
+
+    int Temp;
+    if (Orientation & PAINT_SWAP) {
+        Temp = Xstart; Xstart = Ystart; Ystart = Temp;
+        Temp = Xend; Xend = Yend; Yend = Temp;
+    }
+    if (Orientation & PAINT_FLIP_X) {
+        Temp = Xstart;
+        Xstart = paint->WidthMemory - Xend;
+        Xend = paint->WidthMemory - Temp;
+    }
+    if (Orientation & PAINT_FLIP_Y) {
+        Temp = Ystart;
+        Ystart = paint->HeightMemory - Yend;
+        Yend = paint->HeightMemory - Temp;
+    }
+
+    PAINT_RECT Rect;
+    Rect.Xstart = Xstart & ~7;
+    Rect.Ystart = Ystart;
+    Rect.Xend = (Xend + 7) & ~7;
+    Rect.Yend = Yend;
+    Rect = *Paint_AddDirty(paint, Rect);
+
+    //Back the other way, undoing the flips before the swap
+    Xstart = Rect.Xstart;
+    Xend = (Rect.Xend < paint->WidthMemory)? Rect.Xend : paint->WidthMemory;
+    Ystart = Rect.Ystart;
+    Yend = Rect.Yend;
+    if (Orientation & PAINT_FLIP_Y) {
+        Temp = Ystart;
+        Ystart = paint->HeightMemory - Yend;
+        Yend = paint->HeightMemory - Temp;
+    }
+    if (Orientation & PAINT_FLIP_X) {
+        Temp = Xstart;
+        Xstart = paint->WidthMemory - Xend;
+        Xend = paint->WidthMemory - Temp;
+    }
+    if (Orientation & PAINT_SWAP) {
+        Temp = Xstart; Xstart = Ystart; Ystart = Temp;
+        Temp = Xend; Xend = Yend; Yend = Temp;
+    }
+    paint->DirtyHint.Xstart = Xstart;
+    paint->DirtyHint.Ystart = Ystart;
+    paint->DirtyHint.Xend = Xend;
+    paint->DirtyHint.Yend = Yend;
+}
+
+static inline void Paint_MarkDirty(PAINT *paint, int Xstart, int Ystart, int Xend, int Yend)
+{
+    const PAINT_RECT *Hint = &paint->DirtyHint;
+    if (paint->TrackDirty &&
+        (Xstart < Hint->Xstart || Ystart < Hint->Ystart || Xend > Hint->Xend || Yend > Hint->Yend))
+        Paint_MarkDirtyBox(paint, Xstart, Ystart, Xend, Yend);
+}
+
+/* PAINT.SetPixel while tracking is on, a pixel inside the hint costs four compares more */
+static void Paint_SetPixel_Tracked(PAINT *paint, UWORD Xpoint, UWORD Ypoint, UWORD Color)
+{
+    const PAINT_RECT *Hint = &paint->DirtyHint;
+    if (Xpoint < Hint->Xstart || Ypoint < Hint->Ystart || Xpoint >= Hint->Xend || Ypoint >= Hint->Yend)
+        Paint_MarkDirtyBox(paint, Xpoint, Ypoint, Xpoint + 1, Ypoint + 1);
+    paint->WritePixel(paint, Xpoint, Ypoint, Color);
+}
+
+/******************************************************************************
+function: Turn dirty rectangle tracking on or off
+parameter:
+    Enable : 1 to track, 0 to stop
+info:
+    Either way the list starts empty. Off, drawing costs nothing extra and
+    PaintCtx_GetDirty returns no rectangles.
+******************************************************************************/
+void PaintCtx_SetDirtyTracking(PAINT *paint, UBYTE Enable)
+{
+    paint->TrackDirty = Enable != 0;
+    PaintCtx_ResetDirty(paint);
+    Paint_SelectPixelWriter(paint);
+}
+
+/******************************************************************************
+function: Get the dirty rectangles
+parameter:
+    Rects : Room for PAINT_DIRTY_MAX rectangles
+info:
+    Returns how many there are. They are in memory coordinates, the way the
+    panel takes them, with X a multiple of 8 and the ends not included.
+******************************************************************************/
+UBYTE PaintCtx_GetDirty(PAINT *paint, PAINT_RECT *Rects)
+{
+    memcpy(Rects, paint->Dirty, paint->DirtyCount * sizeof(PAINT_RECT));
+    return paint->DirtyCount;
+}
+
+/******************************************************************************
+function: Forget the dirty rectangles, once the panel shows the image
+******************************************************************************/
+void PaintCtx_ResetDirty(PAINT *paint)
+{
+    paint->DirtyCount = 0;
+    memset(&paint->DirtyHint, 0, sizeof(PAINT_RECT));
+}
+
+/******************************************************************************
+function: Copy a rectangle of a 1 bit image
+parameter:
+    Rect   : A dirty rectangle
+    Target : Room for the rectangle's rows
+info:
+    Packs the rows one after another, as EPD_7IN5_V2_Display_Part wants
+    them. Returns the bytes copied, 0 if the image isn't 1 bit.
+******************************************************************************/
+UDOUBLE PaintCtx_CopyRect(PAINT *paint, const PAINT_RECT *Rect, UBYTE *Target)
+{
+    if (Paint_Format(paint) != 0 || paint->Image == NULL)
+        return 0;
+    UWORD Bytes = (Rect->Xend - Rect->Xstart) / 8;
+    for (UWORD Y = Rect->Ystart; Y < Rect->Yend; Y++) {
+        memcpy(Target, paint->Image + (UDOUBLE)Y * paint->WidthByte + Rect->Xstart / 8, Bytes);
+        Target += Bytes;
+    }
+    return (UDOUBLE)Bytes * (Rect->Yend - Rect->Ystart);
+}
+
 /******************************************************************************
 function: Create Image
 parameter:
@@ -93,30 +459,33 @@ parameter:
     Height  :   The height of the picture
     Color   :   Whether the picture is inverted
 ******************************************************************************/
-void Paint_NewImage(UBYTE *image, UWORD Width, UWORD Height, UWORD Rotate, UWORD Color)
+void PaintCtx_NewImage(PAINT *paint, UBYTE *image, UWORD Width, UWORD Height, UWORD Rotate, UWORD Color)
 {
-    Paint.Image = NULL;
-    Paint.Image = image;
+    paint->Image = NULL;
+    paint->Image = image;
 
-    Paint.WidthMemory = Width;
-    Paint.HeightMemory = Height;
-    Paint.Color = Color;    
-    Paint.Scale = 2;
-    Paint.WidthByte = (Width % 8 == 0)? (Width / 8 ): (Width / 8 + 1);
-    Paint.HeightByte = Height;    
-//    printf("WidthByte = %d, HeightByte = %d\r\n", Paint.WidthByte, Paint.HeightByte);
+    paint->WidthMemory = Width;
+    paint->HeightMemory = Height;
+    paint->Color = Color;    
+    paint->Scale = 2;
+    paint->WidthByte = (Width % 8 == 0)? (Width / 8 ): (Width / 8 + 1);
+    paint->HeightByte = Height;    
+//    printf("WidthByte = %d, HeightByte = %d\r\n", paint->WidthByte, paint->HeightByte);
 //    printf(" EPD_WIDTH / 8 = %d\r\n",  122 / 8);
    
-    Paint.Rotate = Rotate;
-    Paint.Mirror = MIRROR_NONE;
+    paint->Rotate = Rotate;
+    paint->Mirror = MIRROR_NONE;
     
     if(Rotate == ROTATE_0 || Rotate == ROTATE_180) {
-        Paint.Width = Width;
-        Paint.Height = Height;
+        paint->Width = Width;
+        paint->Height = Height;
     } else {
-        Paint.Width = Height;
-        Paint.Height = Width;
+        paint->Width = Height;
+        paint->Height = Width;
     }
+    paint->TrackDirty = 0;
+    PaintCtx_ResetDirty(paint);
+    Paint_SelectPixelWriter(paint);
 }
 
 /******************************************************************************
@@ -124,9 +493,10 @@ function: Select Image
 parameter:
     image : Pointer to the image cache
 ******************************************************************************/
-void Paint_SelectImage(UBYTE *image)
+void PaintCtx_SelectImage(PAINT *paint, UBYTE *image)
 {
-    Paint.Image = image;
+    paint->Image = image;
+    PaintCtx_ResetDirty(paint);
 }
 
 /******************************************************************************
@@ -134,11 +504,12 @@ function: Select Image Rotate
 parameter:
     Rotate : 0,90,180,270
 ******************************************************************************/
-void Paint_SetRotate(UWORD Rotate)
+void PaintCtx_SetRotate(PAINT *paint, UWORD Rotate)
 {
     if(Rotate == ROTATE_0 || Rotate == ROTATE_90 || Rotate == ROTATE_180 || Rotate == ROTATE_270) {
         Debug("Set image Rotate %d\r\n", Rotate);
-        Paint.Rotate = Rotate;
+        paint->Rotate = Rotate;
+        Paint_SelectPixelWriter(paint);
     } else {
         Debug("rotate = 0, 90, 180, 270\r\n");
     }
@@ -149,35 +520,37 @@ function:	Select Image mirror
 parameter:
     mirror   :Not mirror,Horizontal mirror,Vertical mirror,Origin mirror
 ******************************************************************************/
-void Paint_SetMirroring(UBYTE mirror)
+void PaintCtx_SetMirroring(PAINT *paint, UBYTE mirror)
 {
     if(mirror == MIRROR_NONE || mirror == MIRROR_HORIZONTAL || 
         mirror == MIRROR_VERTICAL || mirror == MIRROR_ORIGIN) {
         Debug("mirror image x:%s, y:%s\r\n",(mirror & 0x01)? "mirror":"none", ((mirror >> 1) & 0x01)? "mirror":"none");
-        Paint.Mirror = mirror;
+        paint->Mirror = mirror;
+        Paint_SelectPixelWriter(paint);
     } else {
         Debug("mirror should be MIRROR_NONE, MIRROR_HORIZONTAL, \
         MIRROR_VERTICAL or MIRROR_ORIGIN\r\n");
     }    
 }
 
-void Paint_SetScale(UBYTE scale)
+void PaintCtx_SetScale(PAINT *paint, UBYTE scale)
 {
     if(scale == 2){
-        Paint.Scale = scale;
-        Paint.WidthByte = (Paint.WidthMemory % 8 == 0)? (Paint.WidthMemory / 8 ): (Paint.WidthMemory / 8 + 1);
+        paint->Scale = scale;
+        paint->WidthByte = (paint->WidthMemory % 8 == 0)? (paint->WidthMemory / 8 ): (paint->WidthMemory / 8 + 1);
     }else if(scale == 4){
-        Paint.Scale = scale;
-        Paint.WidthByte = (Paint.WidthMemory % 4 == 0)? (Paint.WidthMemory / 4 ): (Paint.WidthMemory / 4 + 1);
+        paint->Scale = scale;
+        paint->WidthByte = (paint->WidthMemory % 4 == 0)? (paint->WidthMemory / 4 ): (paint->WidthMemory / 4 + 1);
     }else if(scale == 7 || scale == 16){
         /* 7 colours are only applicable with 5in65 e-Paper */
         /* 16 colours are used for dithering */
-		Paint.Scale = scale;
-		Paint.WidthByte = (Paint.WidthMemory % 2 == 0)? (Paint.WidthMemory / 2 ): (Paint.WidthMemory / 2 + 1);;
+		paint->Scale = scale;
+		paint->WidthByte = (paint->WidthMemory % 2 == 0)? (paint->WidthMemory / 2 ): (paint->WidthMemory / 2 + 1);;
 	}else{
         Debug("Set Scale Input parameter error\r\n");
         Debug("Scale Only support: 2 4 7 16\r\n");
     }
+    Paint_SelectPixelWriter(paint);
 }
 /******************************************************************************
 function: Draw Pixels
@@ -186,114 +559,180 @@ parameter:
     Ypoint : At point Y
     Color  : Painted colors
 ******************************************************************************/
-void Paint_SetPixel(UWORD Xpoint, UWORD Ypoint, UWORD Color)
+/* A pixel from a primitive that has marked its box dirty already */
+static inline void Paint_PutPixel(PAINT *paint, UWORD Xpoint, UWORD Ypoint, UWORD Color)
 {
-    if(Xpoint > Paint.Width || Ypoint > Paint.Height){
-        Debug("Exceeding display boundaries\r\n");
-        return;
-    }      
-    UWORD X, Y;
-    switch(Paint.Rotate) {
+    if(paint->WritePixel != NULL)
+        paint->WritePixel(paint, Xpoint, Ypoint, Color);
+}
+
+void PaintCtx_SetPixel(PAINT *paint, UWORD Xpoint, UWORD Ypoint, UWORD Color)
+{
+    if(paint->SetPixel != NULL)
+        paint->SetPixel(paint, Xpoint, Ypoint, Color);
+}
+
+UBYTE PaintCtx_GetPixel(PAINT *paint, UWORD Xpoint, UWORD Ypoint)
+{
+    UDOUBLE Addr = Xpoint / 8 + Ypoint * paint->WidthByte;
+    return paint->Image[Addr];
+}
+
+/******************************************************************************
+function: Fill primitives
+info:
+    Fill rectangles a byte at a time: the partial bytes at either end of each
+    row are masked in and the whole bytes between them are set with memset.
+    Rectangles are clipped the same way Paint_SetPixel clips each pixel, so
+    they end up exactly as if their pixels had been set one by one.
+******************************************************************************/
+/* A byte of pixels of Color, or -1 where there is none: at scales 7 and 16
+   Paint_SetPixel ORs colours past 15 into the neighbouring pixel, so those
+   still go a pixel at a time */
+static int Paint_FillByte(const PAINT *paint, UWORD Color)
+{
+    switch(Paint_Format(paint)) {
     case 0:
-        X = Xpoint;
-        Y = Ypoint;  
-        break;
-    case 90:
-        X = Paint.WidthMemory - Ypoint - 1;
-        Y = Xpoint;
-        break;
-    case 180:
-        X = Paint.WidthMemory - Xpoint - 1;
-        Y = Paint.HeightMemory - Ypoint - 1;
-        break;
-    case 270:
-        X = Ypoint;
-        Y = Paint.HeightMemory - Xpoint - 1;
-        break;
-    default:
-        return;
+        return (Color == BLACK)? 0x00 : 0xFF;
+    case 1:
+        return (Color % 4) * 0x55;
+    case 2:
+        return (Color < 16)? Color * 0x11 : -1;
     }
-    
-    switch(Paint.Mirror) {
-    case MIRROR_NONE:
-        break;
-    case MIRROR_HORIZONTAL:
-        X = Paint.WidthMemory - X - 1;
-        break;
-    case MIRROR_VERTICAL:
-        Y = Paint.HeightMemory - Y - 1;
-        break;
-    case MIRROR_ORIGIN:
-        X = Paint.WidthMemory - X - 1;
-        Y = Paint.HeightMemory - Y - 1;
-        break;
-    default:
+    return -1;
+}
+
+/* Xstart to Xend by Ystart to Yend of the image memory, inclusive */
+static void Paint_FillImageRect(PAINT *paint, UDOUBLE Xstart, UDOUBLE Ystart, UDOUBLE Xend, UDOUBLE Yend, UBYTE Fill)
+{
+    UBYTE Bits = 1 << Paint_Format(paint);
+    UBYTE PerByte = 8 / Bits;
+    UDOUBLE ByteStart = Xstart / PerByte;
+    UDOUBLE ByteEnd = Xend / PerByte;
+    UBYTE HeadMask = 0xFF >> ((Xstart % PerByte) * Bits);
+    UBYTE TailMask = 0xFF << ((PerByte - 1 - Xend % PerByte) * Bits);
+    if(ByteStart == ByteEnd)
+        HeadMask &= TailMask;
+
+    if(HeadMask == 0xFF && TailMask == 0xFF && ByteStart == 0 && ByteEnd + 1 == paint->WidthByte) {
+        memset(paint->Image + Ystart * paint->WidthByte, Fill, (Yend - Ystart + 1) * paint->WidthByte);
         return;
     }
+    for(UDOUBLE Y = Ystart; Y <= Yend; Y++) {
+        UBYTE *Row = paint->Image + Y * paint->WidthByte;
+        Row[ByteStart] = (Row[ByteStart] & ~HeadMask) | (Fill & HeadMask);
+        if(ByteEnd > ByteStart) {
+            memset(Row + ByteStart + 1, Fill, ByteEnd - ByteStart - 1);
+            Row[ByteEnd] = (Row[ByteEnd] & ~TailMask) | (Fill & TailMask);
+        }
+    }
+}
 
-    if(X > Paint.WidthMemory || Y > Paint.HeightMemory){
-        Debug("Exceeding display boundaries\r\n");
+/* Xstart to Xend by Ystart to Yend as drawn, inclusive and clipped to the image */
+static void Paint_FillRectInclusive(PAINT *paint, int Xstart, int Ystart, int Xend, int Yend, UWORD Color)
+{
+    int Orientation = Paint_Orientation(paint->Rotate, paint->Mirror);
+    int Fill = Paint_FillByte(paint, Color);
+    if(paint->Image == NULL || Orientation < 0 || Paint_Format(paint) < 0)
+        return;
+
+    //Paint_SetPixel lets X == Width and Y == Height through
+    if(Xstart < 0)
+        Xstart = 0;
+    if(Ystart < 0)
+        Ystart = 0;
+    if(Xend > paint->Width)
+        Xend = paint->Width;
+    if(Yend > paint->Height)
+        Yend = paint->Height;
+    if(Xstart > Xend || Ystart > Yend)
+        return;
+    Paint_MarkDirty(paint, Xstart, Ystart, Xend + 1, Yend + 1);
+
+    if(Fill < 0) {
+        for(int Y = Ystart; Y <= Yend; Y++)
+            for(int X = Xstart; X <= Xend; X++)
+                paint->WritePixel(paint, X, Y, Color);
         return;
     }
-    
-    if(Paint.Scale == 2){
-        UDOUBLE Addr = X / 8 + Y * Paint.WidthByte;
-        UBYTE Rdata = Paint.Image[Addr];
-        if(Color == BLACK)
-            Paint.Image[Addr] = Rdata & ~(0x80 >> (X % 8));
-        else
-            Paint.Image[Addr] = Rdata | (0x80 >> (X % 8));
-    }else if(Paint.Scale == 4){
-        UDOUBLE Addr = X / 4 + Y * Paint.WidthByte;
-        Color = Color % 4;//Guaranteed color scale is 4  --- 0~3
-        UBYTE Rdata = Paint.Image[Addr];
-        Rdata = Rdata & (~(0xC0 >> ((X % 4)*2)));//Clear first, then set value
-        Paint.Image[Addr] = Rdata | ((Color << 6) >> ((X % 4)*2));
-    }else if(Paint.Scale == 7 || Paint.Scale == 16){
-		UDOUBLE Addr = X / 2  + Y * Paint.WidthByte;
-		UBYTE Rdata = Paint.Image[Addr];
-		Rdata = Rdata & (~(0xF0 >> ((X % 2)*4)));//Clear first, then set value
-		Paint.Image[Addr] = Rdata | ((Color << 4) >> ((X % 2)*4));
-		// printf("Add =  %d ,data = %d\r\n",Addr,Rdata);
-	}
+
+    int Temp;
+    if(Orientation & PAINT_SWAP) {
+        Temp = Xstart; Xstart = Ystart; Ystart = Temp;
+        Temp = Xend; Xend = Yend; Yend = Temp;
+    }
+    if(Orientation & PAINT_FLIP_X) {
+        Temp = Xstart;
+        Xstart = paint->WidthMemory - Xend - 1;
+        Xend = paint->WidthMemory - Temp - 1;
+    }
+    if(Orientation & PAINT_FLIP_Y) {
+        Temp = Ystart;
+        Ystart = paint->HeightMemory - Yend - 1;
+        Yend = paint->HeightMemory - Temp - 1;
+    }
+
+    //A flip past the edge wraps around in UWORD and lands beyond the memory
+    if(Xstart < 0)
+        Xstart = 0;
+    if(Ystart < 0)
+        Ystart = 0;
+    if(Xend > paint->WidthMemory)
+        Xend = paint->WidthMemory;
+    if(Yend > paint->HeightMemory)
+        Yend = paint->HeightMemory;
+    if(Xstart > Xend || Ystart > Yend)
+        return;
+    Paint_FillImageRect(paint, Xstart, Ystart, Xend, Yend, Fill);
 }
 
-UBYTE Paint_GetPixel(UWORD Xpoint, UWORD Ypoint)
+/******************************************************************************
+function: Fill a horizontal span
+parameter:
+    Xstart : x starting point
+    Xend   : x end point, not filled
+    Ypoint : At point Y
+    Color  : Painted colors
+******************************************************************************/
+void PaintCtx_FillSpan(PAINT *paint, UWORD Xstart, UWORD Xend, UWORD Ypoint, UWORD Color)
 {
-    UDOUBLE Addr = Xpoint / 8 + Ypoint * Paint.WidthByte;
-    return Paint.Image[Addr];
+    if(Xend > Xstart)
+        Paint_FillRectInclusive(paint, Xstart, Ypoint, Xend - 1, Ypoint, Color);
 }
 
+/******************************************************************************
+function: Fill a rectangle
+parameter:
+    Xstart : x starting point
+    Ystart : Y starting point
+    Xend   : x end point, not filled
+    Yend   : y end point, not filled
+    Color  : Painted colors
+******************************************************************************/
+void PaintCtx_FillRect(PAINT *paint, UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend, UWORD Color)
+{
+    if(Xend > Xstart && Yend > Ystart)
+        Paint_FillRectInclusive(paint, Xstart, Ystart, Xend - 1, Yend - 1, Color);
+}
 
 /******************************************************************************
 function: Clear the color of the picture
 parameter:
     Color : Painted colors
 ******************************************************************************/
-void Paint_Clear(UWORD Color)
-{	
-	if(Paint.Scale == 2) {
-		for (UWORD Y = 0; Y < Paint.HeightByte; Y++) {
-			for (UWORD X = 0; X < Paint.WidthByte; X++ ) {//8 pixel =  1 byte
-				UDOUBLE Addr = X + Y*Paint.WidthByte;
-				Paint.Image[Addr] = Color;
-			}
-		}		
-    }else if(Paint.Scale == 4) {
-        for (UWORD Y = 0; Y < Paint.HeightByte; Y++) {
-			for (UWORD X = 0; X < Paint.WidthByte; X++ ) {
-				UDOUBLE Addr = X + Y*Paint.WidthByte;
-				Paint.Image[Addr] = (Color<<6)|(Color<<4)|(Color<<2)|Color;
-			}
-		}		
-	}else if(Paint.Scale == 7 || Paint.Scale == 16) {
-		for (UWORD Y = 0; Y < Paint.HeightByte; Y++) {
-			for (UWORD X = 0; X < Paint.WidthByte; X++ ) {
-				UDOUBLE Addr = X + Y*Paint.WidthByte;
-				Paint.Image[Addr] = (Color<<4)|Color;
-			}
-		}		
-	}
+void PaintCtx_Clear(PAINT *paint, UWORD Color)
+{
+    UBYTE Fill;
+    if(paint->Scale == 2)
+        Fill = Color;
+    else if(paint->Scale == 4)
+        Fill = (Color<<6)|(Color<<4)|(Color<<2)|Color;
+    else if(paint->Scale == 7 || paint->Scale == 16)
+        Fill = (Color<<4)|Color;
+    else
+        return;
+    memset(paint->Image, Fill, (UDOUBLE)paint->WidthByte * paint->HeightByte);
+    Paint_MarkDirty(paint, 0, 0, paint->Width, paint->Height);
 }
 
 /******************************************************************************
@@ -305,29 +744,16 @@ parameter:
     Yend   : y end point
     Color  : Painted colors
 ******************************************************************************/
-void Paint_ClearWindows(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend, UWORD Color)
+void PaintCtx_ClearWindows(PAINT *paint, UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend, UWORD Color)
 {
-    UWORD X, Y;
-    for (Y = Ystart; Y < Yend; Y++) {
-        for (X = Xstart; X < Xend; X++) {//8 pixel =  1 byte
-            Paint_SetPixel(X, Y, Color);
-        }
-    }
+    PaintCtx_FillRect(paint, Xstart, Ystart, Xend, Yend, Color);
 }
 
-/******************************************************************************
-function: Draw Point(Xpoint, Ypoint) Fill the color
-parameter:
-    Xpoint		: The Xpoint coordinate of the point
-    Ypoint		: The Ypoint coordinate of the point
-    Color		: Painted color
-    Dot_Pixel	: point size
-    Dot_Style	: point Style
-******************************************************************************/
-void Paint_DrawPoint(UWORD Xpoint, UWORD Ypoint, UWORD Color,
-                     DOT_PIXEL Dot_Pixel, DOT_STYLE Dot_Style)
+/* The points of lines and circles, which mark their whole box dirty beforehand */
+static void Paint_PlotPoint(PAINT *paint, UWORD Xpoint, UWORD Ypoint, UWORD Color,
+                            DOT_PIXEL Dot_Pixel, DOT_STYLE Dot_Style)
 {
-    if (Xpoint > Paint.Width || Ypoint > Paint.Height) {
+    if (Xpoint > paint->Width || Ypoint > paint->Height) {
         Debug("Paint_DrawPoint Input exceeds the normal display range\r\n");
         return;
     }
@@ -339,18 +765,35 @@ void Paint_DrawPoint(UWORD Xpoint, UWORD Ypoint, UWORD Color,
                 if(Xpoint + XDir_Num - Dot_Pixel < 0 || Ypoint + YDir_Num - Dot_Pixel < 0)
                     break;
                 // printf("x = %d, y = %d\r\n", Xpoint + XDir_Num - Dot_Pixel, Ypoint + YDir_Num - Dot_Pixel);
-                Paint_SetPixel(Xpoint + XDir_Num - Dot_Pixel, Ypoint + YDir_Num - Dot_Pixel, Color);
+                Paint_PutPixel(paint, Xpoint + XDir_Num - Dot_Pixel, Ypoint + YDir_Num - Dot_Pixel, Color);
             }
         }
     } else {
         for (XDir_Num = 0; XDir_Num <  Dot_Pixel; XDir_Num++) {
             for (YDir_Num = 0; YDir_Num <  Dot_Pixel; YDir_Num++) {
-                Paint_SetPixel(Xpoint + XDir_Num - 1, Ypoint + YDir_Num - 1, Color);
+                Paint_PutPixel(paint, Xpoint + XDir_Num - 1, Ypoint + YDir_Num - 1, Color);
             }
         }
     }
 }
 
+/******************************************************************************
+function: Draw Point(Xpoint, Ypoint) Fill the color
+parameter:
+    Xpoint		: The Xpoint coordinate of the point
+    Ypoint		: The Ypoint coordinate of the point
+    Color		: Painted color
+    Dot_Pixel	: point size
+    Dot_Style	: point Style
+******************************************************************************/
+void PaintCtx_DrawPoint(PAINT *paint, UWORD Xpoint, UWORD Ypoint, UWORD Color,
+                        DOT_PIXEL Dot_Pixel, DOT_STYLE Dot_Style)
+{
+    if (Xpoint <= paint->Width && Ypoint <= paint->Height)
+        Paint_MarkDirty(paint, Xpoint - Dot_Pixel, Ypoint - Dot_Pixel, Xpoint + Dot_Pixel - 1, Ypoint + Dot_Pixel - 1);
+    Paint_PlotPoint(paint, Xpoint, Ypoint, Color, Dot_Pixel, Dot_Style);
+}
+
 /******************************************************************************
 function: Draw a line of arbitrary slope
 parameter:
@@ -362,14 +805,16 @@ parameter:
     Line_width : Line width
     Line_Style: Solid and dotted lines
 ******************************************************************************/
-void Paint_DrawLine(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend,
-                    UWORD Color, DOT_PIXEL Line_width, LINE_STYLE Line_Style)
+void PaintCtx_DrawLine(PAINT *paint, UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend,
+                       UWORD Color, DOT_PIXEL Line_width, LINE_STYLE Line_Style)
 {
-    if (Xstart > Paint.Width || Ystart > Paint.Height ||
-        Xend > Paint.Width || Yend > Paint.Height) {
+    if (Xstart > paint->Width || Ystart > paint->Height ||
+        Xend > paint->Width || Yend > paint->Height) {
         Debug("Paint_DrawLine Input exceeds the normal display range\r\n");
         return;
     }
+    Paint_MarkDirty(paint, ((Xstart < Xend)? Xstart : Xend) - Line_width, ((Ystart < Yend)? Ystart : Yend) - Line_width,
+                    ((Xstart < Xend)? Xend : Xstart) + Line_width - 1, ((Ystart < Yend)? Yend : Ystart) + Line_width - 1);
 
     UWORD Xpoint = Xstart;
     UWORD Ypoint = Ystart;
@@ -389,10 +834,10 @@ void Paint_DrawLine(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend,
         //Painted dotted line, 2 point is really virtual
         if (Line_Style == LINE_STYLE_DOTTED && Dotted_Len % 3 == 0) {
             //Debug("LINE_DOTTED\r\n");
-            Paint_DrawPoint(Xpoint, Ypoint, IMAGE_BACKGROUND, Line_width, DOT_STYLE_DFT);
+            Paint_PlotPoint(paint, Xpoint, Ypoint, IMAGE_BACKGROUND, Line_width, DOT_STYLE_DFT);
             Dotted_Len = 0;
         } else {
-            Paint_DrawPoint(Xpoint, Ypoint, Color, Line_width, DOT_STYLE_DFT);
+            Paint_PlotPoint(paint, Xpoint, Ypoint, Color, Line_width, DOT_STYLE_DFT);
         }
         if (2 * Esp >= dy) {
             if (Xpoint == Xend)
@@ -420,28 +865,89 @@ parameter:
     Line_width: Line width
     Draw_Fill : Whether to fill the inside of the rectangle
 ******************************************************************************/
-void Paint_DrawRectangle(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend,
-                         UWORD Color, DOT_PIXEL Line_width, DRAW_FILL Draw_Fill)
+void PaintCtx_DrawRectangle(PAINT *paint, UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend,
+                            UWORD Color, DOT_PIXEL Line_width, DRAW_FILL Draw_Fill)
 {
-    if (Xstart > Paint.Width || Ystart > Paint.Height ||
-        Xend > Paint.Width || Yend > Paint.Height) {
+    if (Xstart > paint->Width || Ystart > paint->Height ||
+        Xend > paint->Width || Yend > paint->Height) {
         Debug("Input exceeds the normal display range\r\n");
         return;
     }
 
-    if (Draw_Fill) {
+    if (Draw_Fill && Paint_FillByte(paint, Color) >= 0) {
+        //The pixels of the lines below: each point is a square from Line_width up
+        //and left of it to Line_width - 2 down and right, columns left of the image
+        //are cut off and points whose square starts above it are dropped
+        int Width = Line_width;
+        int Top = (Ystart > Width)? Ystart : Width;
+        UWORD Xleft = (Xstart < Xend)? Xstart : Xend;
+        UWORD Xright = (Xstart < Xend)? Xend : Xstart;
+        if (Top < Yend)
+            Paint_FillRectInclusive(paint, Xleft - Width, Top - Width, Xright + Width - 2, Yend + Width - 3, Color);
+    } else if (Draw_Fill) {
         UWORD Ypoint;
         for(Ypoint = Ystart; Ypoint < Yend; Ypoint++) {
-            Paint_DrawLine(Xstart, Ypoint, Xend, Ypoint, Color , Line_width, LINE_STYLE_SOLID);
+            PaintCtx_DrawLine(paint, Xstart, Ypoint, Xend, Ypoint, Color , Line_width, LINE_STYLE_SOLID);
         }
     } else {
-        Paint_DrawLine(Xstart, Ystart, Xend, Ystart, Color, Line_width, LINE_STYLE_SOLID);
-        Paint_DrawLine(Xstart, Ystart, Xstart, Yend, Color, Line_width, LINE_STYLE_SOLID);
-        Paint_DrawLine(Xend, Yend, Xend, Ystart, Color, Line_width, LINE_STYLE_SOLID);
-        Paint_DrawLine(Xend, Yend, Xstart, Yend, Color, Line_width, LINE_STYLE_SOLID);
+        PaintCtx_DrawLine(paint, Xstart, Ystart, Xend, Ystart, Color, Line_width, LINE_STYLE_SOLID);
+        PaintCtx_DrawLine(paint, Xstart, Ystart, Xstart, Yend, Color, Line_width, LINE_STYLE_SOLID);
+        PaintCtx_DrawLine(paint, Xend, Yend, Xend, Ystart, Color, Line_width, LINE_STYLE_SOLID);
+        PaintCtx_DrawLine(paint, Xend, Yend, Xstart, Yend, Color, Line_width, LINE_STYLE_SOLID);
     }
 }
 
+/* The filled circle of Paint_DrawCircle as spans, 0 if it has to be drawn a point at a time.
+   The points below cover, in each row, everything between the two furthest from the centre,
+   so only how far each row reaches has to be worked out. DOT_PIXEL_1X1 points land up and
+   left of where they are drawn and are dropped at X or Y 0. */
+static UBYTE Paint_FillCircle(PAINT *paint, UWORD X_Center, UWORD Y_Center, UWORD Radius, UWORD Color)
+{
+    if (Paint_FillByte(paint, Color) < 0)
+        return 0;
+    int16_t *Reach = (int16_t *)malloc((Radius + 1) * sizeof(int16_t));
+    if (Reach == NULL)
+        return 0;
+    for (int Row = 0; Row <= Radius; Row++)
+        Reach[Row] = -1;
+
+    int16_t XCurrent = 0, YCurrent = Radius;
+    int16_t Esp = 3 - (Radius << 1 );
+    int16_t sCountY;
+    while (XCurrent <= YCurrent ) {
+        if (YCurrent > Reach[XCurrent])
+            Reach[XCurrent] = YCurrent;
+        for (sCountY = XCurrent; sCountY <= YCurrent; sCountY ++ ) {
+            if (XCurrent > Reach[sCountY])
+                Reach[sCountY] = XCurrent;
+        }
+        if (Esp < 0 )
+            Esp += 4 * XCurrent + 6;
+        else {
+            Esp += 10 + 4 * (XCurrent - YCurrent );
+            YCurrent --;
+        }
+        XCurrent ++;
+    }
+
+    for (int Row = -(int)Radius; Row <= Radius; Row++) {
+        int Across = Reach[abs(Row)];
+        int Ypoint = Y_Center + Row;
+        if (Across < 0 || Ypoint < 1 || Ypoint > paint->Height)
+            continue;
+        int Xleft = X_Center - Across;
+        int Xright = X_Center + Across;
+        if (Xleft < 1)
+            Xleft = 1;
+        if (Xright > paint->Width)
+            Xright = paint->Width;
+        if (Xleft <= Xright)
+            Paint_FillRectInclusive(paint, Xleft - 1, Ypoint - 1, Xright - 1, Ypoint - 1, Color);
+    }
+    free(Reach);
+    return 1;
+}
+
 /******************************************************************************
 function: Use the 8-point method to draw a circle of the
             specified size at the specified position->
@@ -453,13 +959,15 @@ parameter:
     Line_width: Line width
     Draw_Fill : Whether to fill the inside of the Circle
 ******************************************************************************/
-void Paint_DrawCircle(UWORD X_Center, UWORD Y_Center, UWORD Radius,
-                      UWORD Color, DOT_PIXEL Line_width, DRAW_FILL Draw_Fill)
+void PaintCtx_DrawCircle(PAINT *paint, UWORD X_Center, UWORD Y_Center, UWORD Radius,
+                         UWORD Color, DOT_PIXEL Line_width, DRAW_FILL Draw_Fill)
 {
-    if (X_Center > Paint.Width || Y_Center >= Paint.Height) {
+    if (X_Center > paint->Width || Y_Center >= paint->Height) {
         Debug("Paint_DrawCircle Input exceeds the normal display range\r\n");
         return;
     }
+    Paint_MarkDirty(paint, X_Center - Radius - Line_width, Y_Center - Radius - Line_width,
+                    X_Center + Radius + Line_width - 1, Y_Center + Radius + Line_width - 1);
 
     //Draw a circle from(0, R) as a starting point
     int16_t XCurrent, YCurrent;
@@ -470,17 +978,19 @@ void Paint_DrawCircle(UWORD X_Center, UWORD Y_Center, UWORD Radius,
     int16_t Esp = 3 - (Radius << 1 );
 
     int16_t sCountY;
-    if (Draw_Fill == DRAW_FILL_FULL) {
+    if (Draw_Fill == DRAW_FILL_FULL && Paint_FillCircle(paint, X_Center, Y_Center, Radius, Color)) {
+        return;
+    } else if (Draw_Fill == DRAW_FILL_FULL) {
         while (XCurrent <= YCurrent ) { //Realistic circles
             for (sCountY = XCurrent; sCountY <= YCurrent; sCountY ++ ) {
-                Paint_DrawPoint(X_Center + XCurrent, Y_Center + sCountY, Color, DOT_PIXEL_DFT, DOT_STYLE_DFT);//1
-                Paint_DrawPoint(X_Center - XCurrent, Y_Center + sCountY, Color, DOT_PIXEL_DFT, DOT_STYLE_DFT);//2
-                Paint_DrawPoint(X_Center - sCountY, Y_Center + XCurrent, Color, DOT_PIXEL_DFT, DOT_STYLE_DFT);//3
-                Paint_DrawPoint(X_Center - sCountY, Y_Center - XCurrent, Color, DOT_PIXEL_DFT, DOT_STYLE_DFT);//4
-                Paint_DrawPoint(X_Center - XCurrent, Y_Center - sCountY, Color, DOT_PIXEL_DFT, DOT_STYLE_DFT);//5
-                Paint_DrawPoint(X_Center + XCurrent, Y_Center - sCountY, Color, DOT_PIXEL_DFT, DOT_STYLE_DFT);//6
-                Paint_DrawPoint(X_Center + sCountY, Y_Center - XCurrent, Color, DOT_PIXEL_DFT, DOT_STYLE_DFT);//7
-                Paint_DrawPoint(X_Center + sCountY, Y_Center + XCurrent, Color, DOT_PIXEL_DFT, DOT_STYLE_DFT);
+                Paint_PlotPoint(paint, X_Center + XCurrent, Y_Center + sCountY, Color, DOT_PIXEL_DFT, DOT_STYLE_DFT);//1
+                Paint_PlotPoint(paint, X_Center - XCurrent, Y_Center + sCountY, Color, DOT_PIXEL_DFT, DOT_STYLE_DFT);//2
+                Paint_PlotPoint(paint, X_Center - sCountY, Y_Center + XCurrent, Color, DOT_PIXEL_DFT, DOT_STYLE_DFT);//3
+                Paint_PlotPoint(paint, X_Center - sCountY, Y_Center - XCurrent, Color, DOT_PIXEL_DFT, DOT_STYLE_DFT);//4
+                Paint_PlotPoint(paint, X_Center - XCurrent, Y_Center - sCountY, Color, DOT_PIXEL_DFT, DOT_STYLE_DFT);//5
+                Paint_PlotPoint(paint, X_Center + XCurrent, Y_Center - sCountY, Color, DOT_PIXEL_DFT, DOT_STYLE_DFT);//6
+                Paint_PlotPoint(paint, X_Center + sCountY, Y_Center - XCurrent, Color, DOT_PIXEL_DFT, DOT_STYLE_DFT);//7
+                Paint_PlotPoint(paint, X_Center + sCountY, Y_Center + XCurrent, Color, DOT_PIXEL_DFT, DOT_STYLE_DFT);
             }
             if (Esp < 0 )
                 Esp += 4 * XCurrent + 6;
@@ -492,14 +1002,14 @@ void Paint_DrawCircle(UWORD X_Center, UWORD Y_Center, UWORD Radius,
         }
     } else { //Draw a hollow circle
         while (XCurrent <= YCurrent ) {
-            Paint_DrawPoint(X_Center + XCurrent, Y_Center + YCurrent, Color, Line_width, DOT_STYLE_DFT);//1
-            Paint_DrawPoint(X_Center - XCurrent, Y_Center + YCurrent, Color, Line_width, DOT_STYLE_DFT);//2
-            Paint_DrawPoint(X_Center - YCurrent, Y_Center + XCurrent, Color, Line_width, DOT_STYLE_DFT);//3
-            Paint_DrawPoint(X_Center - YCurrent, Y_Center - XCurrent, Color, Line_width, DOT_STYLE_DFT);//4
-            Paint_DrawPoint(X_Center - XCurrent, Y_Center - YCurrent, Color, Line_width, DOT_STYLE_DFT);//5
-            Paint_DrawPoint(X_Center + XCurrent, Y_Center - YCurrent, Color, Line_width, DOT_STYLE_DFT);//6
-            Paint_DrawPoint(X_Center + YCurrent, Y_Center - XCurrent, Color, Line_width, DOT_STYLE_DFT);//7
-            Paint_DrawPoint(X_Center + YCurrent, Y_Center + XCurrent, Color, Line_width, DOT_STYLE_DFT);//0
+            Paint_PlotPoint(paint, X_Center + XCurrent, Y_Center + YCurrent, Color, Line_width, DOT_STYLE_DFT);//1
+            Paint_PlotPoint(paint, X_Center - XCurrent, Y_Center + YCurrent, Color, Line_width, DOT_STYLE_DFT);//2
+            Paint_PlotPoint(paint, X_Center - YCurrent, Y_Center + XCurrent, Color, Line_width, DOT_STYLE_DFT);//3
+            Paint_PlotPoint(paint, X_Center - YCurrent, Y_Center - XCurrent, Color, Line_width, DOT_STYLE_DFT);//4
+            Paint_PlotPoint(paint, X_Center - XCurrent, Y_Center - YCurrent, Color, Line_width, DOT_STYLE_DFT);//5
+            Paint_PlotPoint(paint, X_Center + XCurrent, Y_Center - YCurrent, Color, Line_width, DOT_STYLE_DFT);//6
+            Paint_PlotPoint(paint, X_Center + YCurrent, Y_Center - XCurrent, Color, Line_width, DOT_STYLE_DFT);//7
+            Paint_PlotPoint(paint, X_Center + YCurrent, Y_Center + XCurrent, Color, Line_width, DOT_STYLE_DFT);//0
 
             if (Esp < 0 )
                 Esp += 4 * XCurrent + 6;
@@ -512,6 +1022,191 @@ void Paint_DrawCircle(UWORD X_Center, UWORD Y_Center, UWORD Radius,
     }
 }
 
+/******************************************************************************
+function: Glyph cache
+info:
+    Font tables hold each glyph as rows of bytes, leftmost pixel in the high
+    bit. For 1 bit images a glyph is turned the way the orientation lays it
+    out in memory and stored at all 8 bit offsets within a byte, so drawing a
+    character is a few masked byte writes per row instead of a pixel writer
+    call per pixel. A glyph set is built the first time a font is drawn in an
+    orientation and kept for the life of the program. Once published, a set
+    is never changed, so only building one takes the lock.
+******************************************************************************/
+#define PAINT_GLYPH_SETS    16
+
+typedef struct {
+    const UBYTE *Source;    /* First glyph of the font table */
+    UDOUBLE Stride;         /* Bytes from one glyph to the next */
+    UWORD Count;
+    UWORD Width;
+    UWORD Height;
+    UBYTE *Shifted[8];      /* Indexed by Paint_Orientation, NULL until first drawn */
+} PAINT_GLYPH_SET;
+
+static PAINT_GLYPH_SET Paint_GlyphSets[PAINT_GLYPH_SETS];
+static int Paint_GlyphSetCount = 0;
+static pthread_mutex_t Paint_GlyphLock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Bytes of one shifted row, enough for the glyph at bit offset 7 */
+static UWORD Paint_GlyphRowBytes(UWORD Width)
+{
+    return (Width + 7) / 8 + 1;
+}
+
+/*
+    For each glyph and each bit offset, the memory rows of the glyph, then
+    a mask per bit offset covering the glyph box, all rows Paint_GlyphRowBytes
+    long. Rows run the way they do in memory, top to bottom.
+*/
+static UBYTE *Paint_BuildGlyphs(const PAINT_GLYPH_SET *Set, int Orientation)
+{
+    UWORD WidthMemory = (Orientation & PAINT_SWAP) ? Set->Height : Set->Width;
+    UWORD HeightMemory = (Orientation & PAINT_SWAP) ? Set->Width : Set->Height;
+    UWORD RowBytes = Paint_GlyphRowBytes(WidthMemory);
+    UDOUBLE ShiftBytes = (UDOUBLE)HeightMemory * RowBytes;
+    UDOUBLE GlyphBytes = 8 * ShiftBytes;
+    UWORD SourceRowBytes = (Set->Width + 7) / 8;
+
+    UBYTE *Shifted = (UBYTE *)calloc((UDOUBLE)Set->Count * GlyphBytes + 8 * RowBytes, 1);
+    if (Shifted == NULL)
+        return NULL;
+
+    for (UWORD Glyph = 0; Glyph < Set->Count; Glyph++) {
+        const UBYTE *Source = Set->Source + Glyph * Set->Stride;
+        UBYTE *Target = Shifted + Glyph * GlyphBytes;
+        for (UWORD Row = 0; Row < Set->Height; Row++) {
+            for (UWORD Column = 0; Column < Set->Width; Column++) {
+                if (!(Source[Row * SourceRowBytes + Column / 8] & (0x80 >> (Column % 8))))
+                    continue;
+                UWORD X = (Orientation & PAINT_SWAP) ? Row : Column;
+                UWORD Y = (Orientation & PAINT_SWAP) ? Column : Row;
+                if (Orientation & PAINT_FLIP_X)
+                    X = WidthMemory - X - 1;
+                if (Orientation & PAINT_FLIP_Y)
+                    Y = HeightMemory - Y - 1;
+                for (UWORD Shift = 0; Shift < 8; Shift++)
+                    Target[Shift * ShiftBytes + Y * RowBytes + (X + Shift) / 8] |= 0x80 >> ((X + Shift) % 8);
+            }
+        }
+    }
+
+    UBYTE *Mask = Shifted + Set->Count * GlyphBytes;
+    for (UWORD Shift = 0; Shift < 8; Shift++)
+        for (UWORD X = Shift; X < Shift + WidthMemory; X++)
+            Mask[Shift * RowBytes + X / 8] |= 0x80 >> (X % 8);
+    return Shifted;
+}
+
+/* The glyphs of a font table in an orientation, NULL if they can't be cached */
+static const UBYTE *Paint_GetGlyphs(const UBYTE *Source, UDOUBLE Stride, UWORD Count,
+                                    UWORD Width, UWORD Height, int Orientation)
+{
+    int SetCount = __atomic_load_n(&Paint_GlyphSetCount, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < SetCount; i++) {
+        PAINT_GLYPH_SET *Set = &Paint_GlyphSets[i];
+        if (Set->Source == Source && Set->Stride == Stride && Set->Width == Width && Set->Height == Height) {
+            UBYTE *Shifted = __atomic_load_n(&Set->Shifted[Orientation], __ATOMIC_ACQUIRE);
+            if (Shifted != NULL)
+                return Shifted;
+            break;
+        }
+    }
+
+    pthread_mutex_lock(&Paint_GlyphLock);
+    PAINT_GLYPH_SET *Set = NULL;
+    for (int i = 0; i < Paint_GlyphSetCount; i++) {
+        PAINT_GLYPH_SET *Candidate = &Paint_GlyphSets[i];
+        if (Candidate->Source == Source && Candidate->Stride == Stride && Candidate->Width == Width && Candidate->Height == Height)
+            Set = Candidate;
+    }
+    if (Set == NULL && Paint_GlyphSetCount < PAINT_GLYPH_SETS) {
+        Set = &Paint_GlyphSets[Paint_GlyphSetCount];
+        Set->Source = Source;
+        Set->Stride = Stride;
+        Set->Count = Count;
+        Set->Width = Width;
+        Set->Height = Height;
+        __atomic_store_n(&Paint_GlyphSetCount, Paint_GlyphSetCount + 1, __ATOMIC_RELEASE);
+    }
+    UBYTE *Shifted = NULL;
+    if (Set != NULL) {
+        Shifted = Set->Shifted[Orientation];
+        if (Shifted == NULL) {
+            Shifted = Paint_BuildGlyphs(Set, Orientation);
+            __atomic_store_n(&Set->Shifted[Orientation], Shifted, __ATOMIC_RELEASE);
+        }
+    }
+    pthread_mutex_unlock(&Paint_GlyphLock);
+    return Shifted;
+}
+
+/*
+    Draws glyph Glyph of a cached set with its top left corner at
+    (Xpoint, Ypoint), the way Paint_DrawChar would pixel by pixel. Returns 0
+    without drawing anything if it has to go a pixel at a time instead: the
+    image isn't 1 bit, the glyph isn't wholly inside the image or the glyphs
+    couldn't be cached.
+*/
+static UBYTE Paint_BlitGlyph(PAINT *paint, const UBYTE *Source, UDOUBLE Stride, UWORD Count, UWORD Glyph,
+                             UWORD Width, UWORD Height, UWORD Xpoint, UWORD Ypoint,
+                             UWORD Color_Foreground, UWORD Color_Background)
+{
+    int Orientation = Paint_Orientation(paint->Rotate, paint->Mirror);
+    if (Paint_Format(paint) != 0 || Orientation < 0 || paint->Image == NULL || Glyph >= Count)
+        return 0;
+    if ((UDOUBLE)Xpoint + Width > paint->Width || (UDOUBLE)Ypoint + Height > paint->Height)
+        return 0;
+    const UBYTE *Shifted = Paint_GetGlyphs(Source, Stride, Count, Width, Height, Orientation);
+    if (Shifted == NULL)
+        return 0;
+
+    // The glyph box in memory
+    UWORD WidthMemory = (Orientation & PAINT_SWAP) ? Height : Width;
+    UWORD HeightMemory = (Orientation & PAINT_SWAP) ? Width : Height;
+    UDOUBLE X = (Orientation & PAINT_SWAP) ? Ypoint : Xpoint;
+    UDOUBLE Y = (Orientation & PAINT_SWAP) ? Xpoint : Ypoint;
+    if (Orientation & PAINT_FLIP_X)
+        X = paint->WidthMemory - X - WidthMemory;
+    if (Orientation & PAINT_FLIP_Y)
+        Y = paint->HeightMemory - Y - HeightMemory;
+
+    UWORD RowBytes = Paint_GlyphRowBytes(WidthMemory);
+    UDOUBLE ShiftBytes = (UDOUBLE)HeightMemory * RowBytes;
+    UWORD Shift = X % 8;
+    UWORD Bytes = (Shift + WidthMemory + 7) / 8;
+    const UBYTE *Rows = Shifted + Glyph * 8 * ShiftBytes + Shift * ShiftBytes;
+    const UBYTE *Mask = Shifted + Count * 8 * ShiftBytes + Shift * RowBytes;
+    UBYTE *Target = paint->Image + Y * paint->WidthByte + X / 8;
+
+    UBYTE Foreground = (Color_Foreground == BLACK) ? 0x00 : 0xFF;
+    UBYTE Background = (Color_Background == BLACK) ? 0x00 : 0xFF;
+    for (UWORD Row = 0; Row < HeightMemory; Row++) {
+        if (FONT_BACKGROUND == Color_Background) {
+            // Only the set pixels, the background shows through
+            for (UWORD i = 0; i < Bytes; i++)
+                Target[i] = (Target[i] & ~Rows[i]) | (Rows[i] & Foreground);
+        } else {
+            for (UWORD i = 0; i < Bytes; i++)
+                Target[i] = (Target[i] & ~Mask[i]) | (Rows[i] & Foreground) | (~Rows[i] & Mask[i] & Background);
+        }
+        Rows += RowBytes;
+        Target += paint->WidthByte;
+    }
+    return 1;
+}
+
+/* Glyph of an ASCII character in a font table, which runs from ' ' to '~' */
+static UBYTE Paint_BlitChar(PAINT *paint, UWORD Xpoint, UWORD Ypoint, const char Acsii_Char,
+                            sFONT* Font, UWORD Color_Foreground, UWORD Color_Background)
+{
+    if (Acsii_Char < ' ' || Acsii_Char > '~')
+        return 0;
+    UDOUBLE Stride = (UDOUBLE)Font->Height * ((Font->Width + 7) / 8);
+    return Paint_BlitGlyph(paint, Font->table, Stride, '~' - ' ' + 1, Acsii_Char - ' ',
+                           Font->Width, Font->Height, Xpoint, Ypoint, Color_Foreground, Color_Background);
+}
+
 /******************************************************************************
 function: Show English characters
 parameter:
@@ -522,15 +1217,19 @@ parameter:
     Color_Foreground : Select the foreground color
     Color_Background : Select the background color
 ******************************************************************************/
-void Paint_DrawChar(UWORD Xpoint, UWORD Ypoint, const char Acsii_Char,
-                    sFONT* Font, UWORD Color_Foreground, UWORD Color_Background)
+void PaintCtx_DrawChar(PAINT *paint, UWORD Xpoint, UWORD Ypoint, const char Acsii_Char,
+                       sFONT* Font, UWORD Color_Foreground, UWORD Color_Background)
 {
     UWORD Page, Column;
 
-    if (Xpoint > Paint.Width || Ypoint > Paint.Height) {
+    if (Xpoint > paint->Width || Ypoint > paint->Height) {
         Debug("Paint_DrawChar Input exceeds the normal display range\r\n");
         return;
     }
+    Paint_MarkDirty(paint, Xpoint, Ypoint, Xpoint + Font->Width, Ypoint + Font->Height);
+
+    if (Paint_BlitChar(paint, Xpoint, Ypoint, Acsii_Char, Font, Color_Foreground, Color_Background))
+        return;
 
     uint32_t Char_Offset = (Acsii_Char - ' ') * Font->Height * (Font->Width / 8 + (Font->Width % 8 ? 1 : 0));
     const unsigned char *ptr = &Font->table[Char_Offset];
@@ -541,15 +1240,15 @@ void Paint_DrawChar(UWORD Xpoint, UWORD Ypoint, const char Acsii_Char,
             //To determine whether the font background color and screen background color is consistent
             if (FONT_BACKGROUND == Color_Background) { //this process is to speed up the scan
                 if (*ptr & (0x80 >> (Column % 8)))
-                    Paint_SetPixel(Xpoint + Column, Ypoint + Page, Color_Foreground);
-                    // Paint_DrawPoint(Xpoint + Column, Ypoint + Page, Color_Foreground, DOT_PIXEL_DFT, DOT_STYLE_DFT);
+                    Paint_PutPixel(paint, Xpoint + Column, Ypoint + Page, Color_Foreground);
+                    // PaintCtx_DrawPoint(paint, Xpoint + Column, Ypoint + Page, Color_Foreground, DOT_PIXEL_DFT, DOT_STYLE_DFT);
             } else {
                 if (*ptr & (0x80 >> (Column % 8))) {
-                    Paint_SetPixel(Xpoint + Column, Ypoint + Page, Color_Foreground);
-                    // Paint_DrawPoint(Xpoint + Column, Ypoint + Page, Color_Foreground, DOT_PIXEL_DFT, DOT_STYLE_DFT);
+                    Paint_PutPixel(paint, Xpoint + Column, Ypoint + Page, Color_Foreground);
+                    // PaintCtx_DrawPoint(paint, Xpoint + Column, Ypoint + Page, Color_Foreground, DOT_PIXEL_DFT, DOT_STYLE_DFT);
                 } else {
-                    Paint_SetPixel(Xpoint + Column, Ypoint + Page, Color_Background);
-                    // Paint_DrawPoint(Xpoint + Column, Ypoint + Page, Color_Background, DOT_PIXEL_DFT, DOT_STYLE_DFT);
+                    Paint_PutPixel(paint, Xpoint + Column, Ypoint + Page, Color_Background);
+                    // PaintCtx_DrawPoint(paint, Xpoint + Column, Ypoint + Page, Color_Background, DOT_PIXEL_DFT, DOT_STYLE_DFT);
                 }
             }
             //One pixel is 8 bits
@@ -571,30 +1270,30 @@ parameter:
     Color_Foreground : Select the foreground color
     Color_Background : Select the background color
 ******************************************************************************/
-void Paint_DrawString_EN(UWORD Xstart, UWORD Ystart, const char * pString,
-                         sFONT* Font, UWORD Color_Foreground, UWORD Color_Background)
+void PaintCtx_DrawString_EN(PAINT *paint, UWORD Xstart, UWORD Ystart, const char * pString,
+                            sFONT* Font, UWORD Color_Foreground, UWORD Color_Background)
 {
     UWORD Xpoint = Xstart;
     UWORD Ypoint = Ystart;
 
-    if (Xstart > Paint.Width || Ystart > Paint.Height) {
+    if (Xstart > paint->Width || Ystart > paint->Height) {
         Debug("Paint_DrawString_EN Input exceeds the normal display range\r\n");
         return;
     }
 
     while (* pString != '\0') {
         //if X direction filled , reposition to(Xstart,Ypoint),Ypoint is Y direction plus the Height of the character
-        if ((Xpoint + Font->Width ) > Paint.Width ) {
+        if ((Xpoint + Font->Width ) > paint->Width ) {
             Xpoint = Xstart;
             Ypoint += Font->Height;
         }
 
         // If the Y direction is full, reposition to(Xstart, Ystart)
-        if ((Ypoint  + Font->Height ) > Paint.Height ) {
+        if ((Ypoint  + Font->Height ) > paint->Height ) {
             Xpoint = Xstart;
             Ypoint = Ystart;
         }
-        Paint_DrawChar(Xpoint, Ypoint, * pString, Font, Color_Background, Color_Foreground);
+        PaintCtx_DrawChar(paint, Xpoint, Ypoint, * pString, Font, Color_Background, Color_Foreground);
 
         //The next character of the address
         pString ++;
@@ -605,6 +1304,132 @@ void Paint_DrawString_EN(UWORD Xstart, UWORD Ystart, const char * pString,
 }
 
 
+/******************************************************************************
+function: Chinese font index
+info:
+    Chinese font tables list their glyphs in no particular order, each under
+    the one or two bytes of its GB2312 code. An index of a table is built the
+    first time the font is drawn and kept for the life of the program, like
+    the glyph sets: the first glyph for each single byte and the two byte
+    codes sorted for a binary search. Where a code is listed more than once
+    the first glyph wins, as it did with the scan.
+******************************************************************************/
+#define PAINT_CN_INDEXES    8
+#define PAINT_CN_NONE       0xFFFF
+
+typedef struct {
+    const CH_CN *Table;
+    UWORD Size;
+    UWORD First[256];   /* First glyph by index[0], PAINT_CN_NONE if there is none */
+    UDOUBLE *Codes;     /* Two byte code in the high half and glyph in the low, sorted */
+} PAINT_CN_INDEX;
+
+static PAINT_CN_INDEX Paint_CNIndexes[PAINT_CN_INDEXES];
+static int Paint_CNIndexCount = 0;
+
+static int Paint_CompareCodes(const void *a, const void *b)
+{
+    UDOUBLE A = *(const UDOUBLE *)a, B = *(const UDOUBLE *)b;
+    return (A > B) - (A < B);
+}
+
+static UDOUBLE Paint_CNCode(char First, char Second)
+{
+    return ((UDOUBLE)(UBYTE)First << 8) | (UBYTE)Second;
+}
+
+/* The index of a font table, NULL if it can't be built */
+static const PAINT_CN_INDEX *Paint_GetCNIndex(const cFONT *font)
+{
+    int IndexCount = __atomic_load_n(&Paint_CNIndexCount, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < IndexCount; i++) {
+        if (Paint_CNIndexes[i].Table == font->table && Paint_CNIndexes[i].Size == font->size)
+            return &Paint_CNIndexes[i];
+    }
+
+    pthread_mutex_lock(&Paint_GlyphLock);
+    PAINT_CN_INDEX *Index = NULL;
+    for (int i = 0; i < Paint_CNIndexCount; i++) {
+        if (Paint_CNIndexes[i].Table == font->table && Paint_CNIndexes[i].Size == font->size)
+            Index = &Paint_CNIndexes[i];
+    }
+    if (Index == NULL && Paint_CNIndexCount < PAINT_CN_INDEXES) {
+        UDOUBLE *Codes = (UDOUBLE *)malloc((font->size + 1) * sizeof(UDOUBLE));
+        if (Codes != NULL) {
+            Index = &Paint_CNIndexes[Paint_CNIndexCount];
+            Index->Table = font->table;
+            Index->Size = font->size;
+            Index->Codes = Codes;
+            for (int i = 0; i < 256; i++)
+                Index->First[i] = PAINT_CN_NONE;
+            for (UWORD Num = 0; Num < font->size; Num++) {
+                UBYTE Byte = font->table[Num].index[0];
+                if (Index->First[Byte] == PAINT_CN_NONE)
+                    Index->First[Byte] = Num;
+                Codes[Num] = (Paint_CNCode(font->table[Num].index[0], font->table[Num].index[1]) << 16) | Num;
+            }
+            qsort(Codes, font->size, sizeof(UDOUBLE), Paint_CompareCodes);
+            __atomic_store_n(&Paint_CNIndexCount, Paint_CNIndexCount + 1, __ATOMIC_RELEASE);
+        }
+    }
+    pthread_mutex_unlock(&Paint_GlyphLock);
+    return Index;
+}
+
+/* First glyph listed under a two byte code, PAINT_CN_NONE if there is none */
+static UWORD Paint_FindCN(const PAINT_CN_INDEX *Index, char First, char Second)
+{
+    UDOUBLE Key = Paint_CNCode(First, Second) << 16;
+    UDOUBLE Low = 0, High = Index->Size;
+    while (Low < High) {
+        UDOUBLE Middle = (Low + High) / 2;
+        if (Index->Codes[Middle] < Key)
+            Low = Middle + 1;
+        else
+            High = Middle;
+    }
+    if (Low < Index->Size && (Index->Codes[Low] >> 16) == (Key >> 16))
+        return Index->Codes[Low] & 0xFFFF;
+    return PAINT_CN_NONE;
+}
+
+/* Glyph Num of a Chinese font, whole rows at a time where it can */
+static void Paint_DrawCNGlyph(PAINT *paint, int x, int y, cFONT* font, UWORD Num,
+                              UWORD Color_Foreground, UWORD Color_Background)
+{
+    Paint_MarkDirty(paint, x, y, x + font->Width, y + font->Height);
+    if (Paint_BlitGlyph(paint, (const UBYTE *)font->table[0].matrix, sizeof(CH_CN), font->size, Num,
+                        font->Width, font->Height, x, y, Color_Foreground, Color_Background))
+        return;
+
+    const char* ptr = &font->table[Num].matrix[0];
+    int i, j;
+    for (j = 0; j < font->Height; j++) {
+        for (i = 0; i < font->Width; i++) {
+            if (FONT_BACKGROUND == Color_Background) { //this process is to speed up the scan
+                if (*ptr & (0x80 >> (i % 8))) {
+                    Paint_PutPixel(paint, x + i, y + j, Color_Foreground);
+                    // PaintCtx_DrawPoint(paint, x + i, y + j, Color_Foreground, DOT_PIXEL_DFT, DOT_STYLE_DFT);
+                }
+            } else {
+                if (*ptr & (0x80 >> (i % 8))) {
+                    Paint_PutPixel(paint, x + i, y + j, Color_Foreground);
+                    // PaintCtx_DrawPoint(paint, x + i, y + j, Color_Foreground, DOT_PIXEL_DFT, DOT_STYLE_DFT);
+                } else {
+                    Paint_PutPixel(paint, x + i, y + j, Color_Background);
+                    // PaintCtx_DrawPoint(paint, x + i, y + j, Color_Background, DOT_PIXEL_DFT, DOT_STYLE_DFT);
+                }
+            }
+            if (i % 8 == 7) {
+                ptr++;
+            }
+        }
+        if (font->Width % 8 != 0) {
+            ptr++;
+        }
+    }
+}
+
 /******************************************************************************
 function: Display the string
 parameter:
@@ -616,83 +1441,46 @@ parameter:
     Color_Foreground : Select the foreground color
     Color_Background : Select the background color
 ******************************************************************************/
-void Paint_DrawString_CN(UWORD Xstart, UWORD Ystart, const char * pString, cFONT* font,
-                        UWORD Color_Foreground, UWORD Color_Background)
+void PaintCtx_DrawString_CN(PAINT *paint, UWORD Xstart, UWORD Ystart, const char * pString, cFONT* font,
+                           UWORD Color_Foreground, UWORD Color_Background)
 {
     const char* p_text = pString;
     int x = Xstart, y = Ystart;
-    int i, j,Num;
+    UWORD Num;
+    const PAINT_CN_INDEX *Index = Paint_GetCNIndex(font);
 
     /* Send the string character by character on EPD */
     while (*p_text != 0) {
-        if(*p_text <= 0x7F) {  //ASCII < 126
-            for(Num = 0; Num < font->size; Num++) {
-                if(*p_text== font->table[Num].index[0]) {
-                    const char* ptr = &font->table[Num].matrix[0];
-
-                    for (j = 0; j < font->Height; j++) {
-                        for (i = 0; i < font->Width; i++) {
-                            if (FONT_BACKGROUND == Color_Background) { //this process is to speed up the scan
-                                if (*ptr & (0x80 >> (i % 8))) {
-                                    Paint_SetPixel(x + i, y + j, Color_Foreground);
-                                    // Paint_DrawPoint(x + i, y + j, Color_Foreground, DOT_PIXEL_DFT, DOT_STYLE_DFT);
-                                }
-                            } else {
-                                if (*ptr & (0x80 >> (i % 8))) {
-                                    Paint_SetPixel(x + i, y + j, Color_Foreground);
-                                    // Paint_DrawPoint(x + i, y + j, Color_Foreground, DOT_PIXEL_DFT, DOT_STYLE_DFT);
-                                } else {
-                                    Paint_SetPixel(x + i, y + j, Color_Background);
-                                    // Paint_DrawPoint(x + i, y + j, Color_Background, DOT_PIXEL_DFT, DOT_STYLE_DFT);
-                                }
-                            }
-                            if (i % 8 == 7) {
-                                ptr++;
-                            }
-                        }
-                        if (font->Width % 8 != 0) {
-                            ptr++;
-                        }
-                    }
-                    break;
-                }
+        if((UBYTE)*p_text <= 0x7F) {  //ASCII < 126
+            if (Index != NULL) {
+                Num = Index->First[(UBYTE)*p_text];
+            } else {
+                for(Num = 0; Num < font->size && *p_text != font->table[Num].index[0]; Num++);
+                if (Num == font->size)
+                    Num = PAINT_CN_NONE;
             }
+            if (Num != PAINT_CN_NONE)
+                Paint_DrawCNGlyph(paint, x, y, font, Num, Color_Foreground, Color_Background);
             /* Point on the next character */
             p_text += 1;
             /* Decrement the column position by 16 */
             x += font->ASCII_Width;
         } else {        //Chinese
-            for(Num = 0; Num < font->size; Num++) {
-                if((*p_text== font->table[Num].index[0]) && (*(p_text+1) == font->table[Num].index[1])) {
-                    const char* ptr = &font->table[Num].matrix[0];
-
-                    for (j = 0; j < font->Height; j++) {
-                        for (i = 0; i < font->Width; i++) {
-                            if (FONT_BACKGROUND == Color_Background) { //this process is to speed up the scan
-                                if (*ptr & (0x80 >> (i % 8))) {
-                                    Paint_SetPixel(x + i, y + j, Color_Foreground);
-                                    // Paint_DrawPoint(x + i, y + j, Color_Foreground, DOT_PIXEL_DFT, DOT_STYLE_DFT);
-                                }
-                            } else {
-                                if (*ptr & (0x80 >> (i % 8))) {
-                                    Paint_SetPixel(x + i, y + j, Color_Foreground);
-                                    // Paint_DrawPoint(x + i, y + j, Color_Foreground, DOT_PIXEL_DFT, DOT_STYLE_DFT);
-                                } else {
-                                    Paint_SetPixel(x + i, y + j, Color_Background);
-                                    // Paint_DrawPoint(x + i, y + j, Color_Background, DOT_PIXEL_DFT, DOT_STYLE_DFT);
-                                }
-                            }
-                            if (i % 8 == 7) {
-                                ptr++;
-                            }
-                        }
-                        if (font->Width % 8 != 0) {
-                            ptr++;
-                        }
-                    }
-                    break;
+            if (Index != NULL) {
+                Num = Paint_FindCN(Index, *p_text, *(p_text+1));
+            } else {
+                for(Num = 0; Num < font->size; Num++) {
+                    if((*p_text== font->table[Num].index[0]) && (*(p_text+1) == font->table[Num].index[1]))
+                        break;
                 }
+                if (Num == font->size)
+                    Num = PAINT_CN_NONE;
             }
+            if (Num != PAINT_CN_NONE)
+                Paint_DrawCNGlyph(paint, x, y, font, Num, Color_Foreground, Color_Background);
+            /* A lead byte with nothing after it ends the string */
+            if (*(p_text+1) == 0)
+                break;
             /* Point on the next character */
             p_text += 2;
             /* Decrement the column position by 16 */
@@ -712,15 +1500,15 @@ parameter:
     Color_Background : Select the background color
 ******************************************************************************/
 #define  ARRAY_LEN 255
-void Paint_DrawNum(UWORD Xpoint, UWORD Ypoint, int32_t Nummber,
-                   sFONT* Font, UWORD Color_Foreground, UWORD Color_Background)
+void PaintCtx_DrawNum(PAINT *paint, UWORD Xpoint, UWORD Ypoint, int32_t Nummber,
+                      sFONT* Font, UWORD Color_Foreground, UWORD Color_Background)
 {
 
     int16_t Num_Bit = 0, Str_Bit = 0;
     uint8_t Str_Array[ARRAY_LEN] = {0}, Num_Array[ARRAY_LEN] = {0};
     uint8_t *pStr = Str_Array;
 
-    if (Xpoint > Paint.Width || Ypoint > Paint.Height) {
+    if (Xpoint > paint->Width || Ypoint > paint->Height) {
         Debug("Paint_DisNum Input exceeds the normal display range\r\n");
         return;
     }
@@ -741,7 +1529,7 @@ void Paint_DrawNum(UWORD Xpoint, UWORD Ypoint, int32_t Nummber,
     }
 
     //show
-    Paint_DrawString_EN(Xpoint, Ypoint, (const char*)pStr, Font, Color_Background, Color_Foreground);
+    PaintCtx_DrawString_EN(paint, Xpoint, Ypoint, (const char*)pStr, Font, Color_Background, Color_Foreground);
 }
 
 /******************************************************************************
@@ -755,8 +1543,8 @@ parameter:
     Color_Foreground : Select the foreground color
     Color_Background : Select the background color
 ******************************************************************************/
-void Paint_DrawNumDecimals(UWORD Xpoint, UWORD Ypoint, double Nummber,
-                    sFONT* Font, UWORD Digit, UWORD Color_Foreground, UWORD Color_Background)
+void PaintCtx_DrawNumDecimals(PAINT *paint, UWORD Xpoint, UWORD Ypoint, double Nummber,
+                       sFONT* Font, UWORD Digit, UWORD Color_Foreground, UWORD Color_Background)
 {
     int16_t Num_Bit = 0, Str_Bit = 0;
     uint8_t Str_Array[ARRAY_LEN] = {0}, Num_Array[ARRAY_LEN] = {0};
@@ -764,7 +1552,7 @@ void Paint_DrawNumDecimals(UWORD Xpoint, UWORD Ypoint, double Nummber,
 	int temp = Nummber;
 	float decimals;
 	uint8_t i;
-    if (Xpoint > Paint.Width || Ypoint > Paint.Height) {
+    if (Xpoint > paint->Width || Ypoint > paint->Height) {
         Debug("Paint_DisNum Input exceeds the normal display range\r\n");
         return;
     }
@@ -801,7 +1589,7 @@ void Paint_DrawNumDecimals(UWORD Xpoint, UWORD Ypoint, double Nummber,
     }
 
     //show
-    Paint_DrawString_EN(Xpoint, Ypoint, (const char*)pStr, Font, Color_Background, Color_Foreground);
+    PaintCtx_DrawString_EN(paint, Xpoint, Ypoint, (const char*)pStr, Font, Color_Background, Color_Foreground);
 }
 
 /******************************************************************************
@@ -814,22 +1602,22 @@ parameter:
     Color_Foreground : Select the foreground color
     Color_Background : Select the background color
 ******************************************************************************/
-void Paint_DrawTime(UWORD Xstart, UWORD Ystart, PAINT_TIME *pTime, sFONT* Font,
-                    UWORD Color_Foreground, UWORD Color_Background)
+void PaintCtx_DrawTime(PAINT *paint, UWORD Xstart, UWORD Ystart, PAINT_TIME *pTime, sFONT* Font,
+                       UWORD Color_Foreground, UWORD Color_Background)
 {
     uint8_t value[10] = {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9'};
 
     UWORD Dx = Font->Width;
 
     //Write data into the cache
-    Paint_DrawChar(Xstart                           , Ystart, value[pTime->Hour / 10], Font, Color_Background, Color_Foreground);
-    Paint_DrawChar(Xstart + Dx                      , Ystart, value[pTime->Hour % 10], Font, Color_Background, Color_Foreground);
-    Paint_DrawChar(Xstart + Dx  + Dx / 4 + Dx / 2   , Ystart, ':'                    , Font, Color_Background, Color_Foreground);
-    Paint_DrawChar(Xstart + Dx * 2 + Dx / 2         , Ystart, value[pTime->Min / 10] , Font, Color_Background, Color_Foreground);
-    Paint_DrawChar(Xstart + Dx * 3 + Dx / 2         , Ystart, value[pTime->Min % 10] , Font, Color_Background, Color_Foreground);
-    Paint_DrawChar(Xstart + Dx * 4 + Dx / 2 - Dx / 4, Ystart, ':'                    , Font, Color_Background, Color_Foreground);
-    Paint_DrawChar(Xstart + Dx * 5                  , Ystart, value[pTime->Sec / 10] , Font, Color_Background, Color_Foreground);
-    Paint_DrawChar(Xstart + Dx * 6                  , Ystart, value[pTime->Sec % 10] , Font, Color_Background, Color_Foreground);
+    PaintCtx_DrawChar(paint, Xstart                           , Ystart, value[pTime->Hour / 10], Font, Color_Background, Color_Foreground);
+    PaintCtx_DrawChar(paint, Xstart + Dx                      , Ystart, value[pTime->Hour % 10], Font, Color_Background, Color_Foreground);
+    PaintCtx_DrawChar(paint, Xstart + Dx  + Dx / 4 + Dx / 2   , Ystart, ':'                    , Font, Color_Background, Color_Foreground);
+    PaintCtx_DrawChar(paint, Xstart + Dx * 2 + Dx / 2         , Ystart, value[pTime->Min / 10] , Font, Color_Background, Color_Foreground);
+    PaintCtx_DrawChar(paint, Xstart + Dx * 3 + Dx / 2         , Ystart, value[pTime->Min % 10] , Font, Color_Background, Color_Foreground);
+    PaintCtx_DrawChar(paint, Xstart + Dx * 4 + Dx / 2 - Dx / 4, Ystart, ':'                    , Font, Color_Background, Color_Foreground);
+    PaintCtx_DrawChar(paint, Xstart + Dx * 5                  , Ystart, value[pTime->Sec / 10] , Font, Color_Background, Color_Foreground);
+    PaintCtx_DrawChar(paint, Xstart + Dx * 6                  , Ystart, value[pTime->Sec % 10] , Font, Color_Background, Color_Foreground);
 }
 
 /******************************************************************************
@@ -840,15 +1628,369 @@ info:
     Use a computer to convert the image into a corresponding array,
     and then embed the array directly into Imagedata.cpp as a .c file.
 ******************************************************************************/
-void Paint_DrawBitMap(const unsigned char* image_buffer)
+void PaintCtx_DrawBitMap(PAINT *paint, const unsigned char* image_buffer)
 {
     UWORD x, y;
     UDOUBLE Addr = 0;
+    Paint_MarkDirty(paint, 0, 0, paint->Width, paint->Height);
+
+    for (y = 0; y < paint->HeightByte; y++) {
+        for (x = 0; x < paint->WidthByte; x++) {//8 pixel =  1 byte
+            Addr = x + y * paint->WidthByte;
+            paint->Image[Addr] = (unsigned char)image_buffer[Addr];
+        }
+    }
+}
+
+/******************************************************************************
+function: The global image
+info:
+    The Paint_ functions below draw into the global Paint, as the Waveshare
+    examples expect. Every PaintCtx_ function touches only the PAINT it is
+    handed, so threads drawing at the same time each need a PAINT and an
+    image of their own; one PAINT must not be shared between threads.
+******************************************************************************/
+void Paint_NewImage(UBYTE *image, UWORD Width, UWORD Height, UWORD Rotate, UWORD Color)
+{
+    PaintCtx_NewImage(&Paint, image, Width, Height, Rotate, Color);
+}
+
+void Paint_SelectImage(UBYTE *image)
+{
+    PaintCtx_SelectImage(&Paint, image);
+}
+
+void Paint_SetRotate(UWORD Rotate)
+{
+    PaintCtx_SetRotate(&Paint, Rotate);
+}
+
+void Paint_SetMirroring(UBYTE mirror)
+{
+    PaintCtx_SetMirroring(&Paint, mirror);
+}
+
+void Paint_SetScale(UBYTE scale)
+{
+    PaintCtx_SetScale(&Paint, scale);
+}
+
+void Paint_SetPixel(UWORD Xpoint, UWORD Ypoint, UWORD Color)
+{
+    //Straight to the writer, without going through PaintCtx_SetPixel as well
+    if(Paint.SetPixel != NULL)
+        Paint.SetPixel(&Paint, Xpoint, Ypoint, Color);
+}
+
+UBYTE Paint_GetPixel(UWORD Xpoint, UWORD Ypoint)
+{
+    return PaintCtx_GetPixel(&Paint, Xpoint, Ypoint);
+}
+
+void Paint_FillSpan(UWORD Xstart, UWORD Xend, UWORD Ypoint, UWORD Color)
+{
+    PaintCtx_FillSpan(&Paint, Xstart, Xend, Ypoint, Color);
+}
+
+void Paint_FillRect(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend, UWORD Color)
+{
+    PaintCtx_FillRect(&Paint, Xstart, Ystart, Xend, Yend, Color);
+}
+
+void Paint_Clear(UWORD Color)
+{
+    PaintCtx_Clear(&Paint, Color);
+}
 
-    for (y = 0; y < Paint.HeightByte; y++) {
-        for (x = 0; x < Paint.WidthByte; x++) {//8 pixel =  1 byte
-            Addr = x + y * Paint.WidthByte;
-            Paint.Image[Addr] = (unsigned char)image_buffer[Addr];
+void Paint_ClearWindows(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend, UWORD Color)
+{
+    PaintCtx_ClearWindows(&Paint, Xstart, Ystart, Xend, Yend, Color);
+}
+
+void Paint_DrawPoint(UWORD Xpoint, UWORD Ypoint, UWORD Color,
+                     DOT_PIXEL Dot_Pixel, DOT_STYLE Dot_Style)
+{
+    PaintCtx_DrawPoint(&Paint, Xpoint, Ypoint, Color, Dot_Pixel, Dot_Style);
+}
+
+void Paint_DrawLine(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend,
+                    UWORD Color, DOT_PIXEL Line_width, LINE_STYLE Line_Style)
+{
+    PaintCtx_DrawLine(&Paint, Xstart, Ystart, Xend, Yend, Color, Line_width, Line_Style);
+}
+
+void Paint_DrawRectangle(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend,
+                         UWORD Color, DOT_PIXEL Line_width, DRAW_FILL Draw_Fill)
+{
+    PaintCtx_DrawRectangle(&Paint, Xstart, Ystart, Xend, Yend, Color, Line_width, Draw_Fill);
+}
+
+void Paint_DrawCircle(UWORD X_Center, UWORD Y_Center, UWORD Radius,
+                      UWORD Color, DOT_PIXEL Line_width, DRAW_FILL Draw_Fill)
+{
+    PaintCtx_DrawCircle(&Paint, X_Center, Y_Center, Radius, Color, Line_width, Draw_Fill);
+}
+
+void Paint_DrawChar(UWORD Xpoint, UWORD Ypoint, const char Acsii_Char,
+                    sFONT* Font, UWORD Color_Foreground, UWORD Color_Background)
+{
+    PaintCtx_DrawChar(&Paint, Xpoint, Ypoint, Acsii_Char, Font, Color_Foreground, Color_Background);
+}
+
+void Paint_DrawString_EN(UWORD Xstart, UWORD Ystart, const char * pString,
+                         sFONT* Font, UWORD Color_Foreground, UWORD Color_Background)
+{
+    PaintCtx_DrawString_EN(&Paint, Xstart, Ystart, pString, Font, Color_Foreground, Color_Background);
+}
+
+void Paint_DrawString_CN(UWORD Xstart, UWORD Ystart, const char * pString, cFONT* font,
+                        UWORD Color_Foreground, UWORD Color_Background)
+{
+    PaintCtx_DrawString_CN(&Paint, Xstart, Ystart, pString, font, Color_Foreground, Color_Background);
+}
+
+void Paint_DrawNum(UWORD Xpoint, UWORD Ypoint, int32_t Nummber,
+                   sFONT* Font, UWORD Color_Foreground, UWORD Color_Background)
+{
+    PaintCtx_DrawNum(&Paint, Xpoint, Ypoint, Nummber, Font, Color_Foreground, Color_Background);
+}
+
+void Paint_DrawNumDecimals(UWORD Xpoint, UWORD Ypoint, double Nummber,
+                    sFONT* Font, UWORD Digit, UWORD Color_Foreground, UWORD Color_Background)
+{
+    PaintCtx_DrawNumDecimals(&Paint, Xpoint, Ypoint, Nummber, Font, Digit, Color_Foreground, Color_Background);
+}
+
+void Paint_DrawTime(UWORD Xstart, UWORD Ystart, PAINT_TIME *pTime, sFONT* Font,
+                    UWORD Color_Foreground, UWORD Color_Background)
+{
+    PaintCtx_DrawTime(&Paint, Xstart, Ystart, pTime, Font, Color_Foreground, Color_Background);
+}
+
+void Paint_DrawBitMap(const unsigned char* image_buffer)
+{
+    PaintCtx_DrawBitMap(&Paint, image_buffer);
+}
+
+void Paint_SetDirtyTracking(UBYTE Enable)
+{
+    PaintCtx_SetDirtyTracking(&Paint, Enable);
+}
+
+UBYTE Paint_GetDirty(PAINT_RECT *Rects)
+{
+    return PaintCtx_GetDirty(&Paint, Rects);
+}
+
+void Paint_ResetDirty(void)
+{
+    PaintCtx_ResetDirty(&Paint);
+}
+
+UDOUBLE Paint_CopyRect(const PAINT_RECT *Rect, UBYTE *Target)
+{
+    return PaintCtx_CopyRect(&Paint, Rect, Target);
+}
+
+/******************************************************************************
+function: Whole image rotate and mirror
+info:
+    The bits of an 8x8 block of a 1 bit image are packed into a 64 bit word,
+    row 0 in the low byte and the leftmost pixel in the high bit of each byte.
+    Transposing that word the usual way flips the block about its other
+    diagonal, which is a swap of X and Y plus both flips, so the flips the
+    orientation asks for are applied on top of that.
+******************************************************************************/
+static uint64_t Paint_TransposeBits(uint64_t x)
+{
+    uint64_t t;
+    t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAULL;
+    x = x ^ t ^ (t << 7);
+    t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL;
+    x = x ^ t ^ (t << 14);
+    t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL;
+    x = x ^ t ^ (t << 28);
+    return x;
+}
+
+static uint64_t Paint_ReverseBits(uint64_t x)
+{
+    x = ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+    x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+    x = ((x >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((x & 0x0F0F0F0F0F0F0F0FULL) << 4);
+    return x;
+}
+
+/* Transposed blocks of 8 rows and Count byte columns of Source */
+static void Paint_TransposeBlocks(const UBYTE *Source, UDOUBLE Stride, UWORD Count, uint64_t *Blocks)
+{
+    UWORD Column = 0;
+#if defined(__SSE2__)
+    //16 columns at a time: interleaving the rows byte by byte gathers each column's
+    //8 bytes into a 64 bit lane, and the transpose then works on two lanes at once
+    for (; Column + 16 <= Count; Column += 16) {
+        const UBYTE *Top = Source + Column;
+        __m128i r0 = _mm_loadu_si128((const __m128i *)(Top));
+        __m128i r1 = _mm_loadu_si128((const __m128i *)(Top + Stride));
+        __m128i r2 = _mm_loadu_si128((const __m128i *)(Top + Stride * 2));
+        __m128i r3 = _mm_loadu_si128((const __m128i *)(Top + Stride * 3));
+        __m128i r4 = _mm_loadu_si128((const __m128i *)(Top + Stride * 4));
+        __m128i r5 = _mm_loadu_si128((const __m128i *)(Top + Stride * 5));
+        __m128i r6 = _mm_loadu_si128((const __m128i *)(Top + Stride * 6));
+        __m128i r7 = _mm_loadu_si128((const __m128i *)(Top + Stride * 7));
+        __m128i a01l = _mm_unpacklo_epi8(r0, r1), a01h = _mm_unpackhi_epi8(r0, r1);
+        __m128i a23l = _mm_unpacklo_epi8(r2, r3), a23h = _mm_unpackhi_epi8(r2, r3);
+        __m128i a45l = _mm_unpacklo_epi8(r4, r5), a45h = _mm_unpackhi_epi8(r4, r5);
+        __m128i a67l = _mm_unpacklo_epi8(r6, r7), a67h = _mm_unpackhi_epi8(r6, r7);
+        __m128i b[4][2] = {
+            {_mm_unpacklo_epi16(a01l, a23l), _mm_unpacklo_epi16(a45l, a67l)},
+            {_mm_unpackhi_epi16(a01l, a23l), _mm_unpackhi_epi16(a45l, a67l)},
+            {_mm_unpacklo_epi16(a01h, a23h), _mm_unpacklo_epi16(a45h, a67h)},
+            {_mm_unpackhi_epi16(a01h, a23h), _mm_unpackhi_epi16(a45h, a67h)},
+        };
+        for (int i = 0; i < 8; i++) {
+            __m128i x = (i & 1)? _mm_unpackhi_epi32(b[i / 2][0], b[i / 2][1]) : _mm_unpacklo_epi32(b[i / 2][0], b[i / 2][1]);
+            __m128i t;
+            t = _mm_and_si128(_mm_xor_si128(x, _mm_srli_epi64(x, 7)), _mm_set1_epi64x(0x00AA00AA00AA00AALL));
+            x = _mm_xor_si128(_mm_xor_si128(x, t), _mm_slli_epi64(t, 7));
+            t = _mm_and_si128(_mm_xor_si128(x, _mm_srli_epi64(x, 14)), _mm_set1_epi64x(0x0000CCCC0000CCCCLL));
+            x = _mm_xor_si128(_mm_xor_si128(x, t), _mm_slli_epi64(t, 14));
+            t = _mm_and_si128(_mm_xor_si128(x, _mm_srli_epi64(x, 28)), _mm_set1_epi64x(0x00000000F0F0F0F0LL));
+            x = _mm_xor_si128(_mm_xor_si128(x, t), _mm_slli_epi64(t, 28));
+            _mm_storeu_si128((__m128i *)(Blocks + Column + i * 2), x);
+        }
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (; Column + 16 <= Count; Column += 16) {
+        const UBYTE *Top = Source + Column;
+        uint8x16_t r0 = vld1q_u8(Top);
+        uint8x16_t r1 = vld1q_u8(Top + Stride);
+        uint8x16_t r2 = vld1q_u8(Top + Stride * 2);
+        uint8x16_t r3 = vld1q_u8(Top + Stride * 3);
+        uint8x16_t r4 = vld1q_u8(Top + Stride * 4);
+        uint8x16_t r5 = vld1q_u8(Top + Stride * 5);
+        uint8x16_t r6 = vld1q_u8(Top + Stride * 6);
+        uint8x16_t r7 = vld1q_u8(Top + Stride * 7);
+        uint16x8_t a01l = vreinterpretq_u16_u8(vzip1q_u8(r0, r1)), a01h = vreinterpretq_u16_u8(vzip2q_u8(r0, r1));
+        uint16x8_t a23l = vreinterpretq_u16_u8(vzip1q_u8(r2, r3)), a23h = vreinterpretq_u16_u8(vzip2q_u8(r2, r3));
+        uint16x8_t a45l = vreinterpretq_u16_u8(vzip1q_u8(r4, r5)), a45h = vreinterpretq_u16_u8(vzip2q_u8(r4, r5));
+        uint16x8_t a67l = vreinterpretq_u16_u8(vzip1q_u8(r6, r7)), a67h = vreinterpretq_u16_u8(vzip2q_u8(r6, r7));
+        uint32x4_t b[4][2] = {
+            {vreinterpretq_u32_u16(vzip1q_u16(a01l, a23l)), vreinterpretq_u32_u16(vzip1q_u16(a45l, a67l))},
+            {vreinterpretq_u32_u16(vzip2q_u16(a01l, a23l)), vreinterpretq_u32_u16(vzip2q_u16(a45l, a67l))},
+            {vreinterpretq_u32_u16(vzip1q_u16(a01h, a23h)), vreinterpretq_u32_u16(vzip1q_u16(a45h, a67h))},
+            {vreinterpretq_u32_u16(vzip2q_u16(a01h, a23h)), vreinterpretq_u32_u16(vzip2q_u16(a45h, a67h))},
+        };
+        for (int i = 0; i < 8; i++) {
+            uint64x2_t x = vreinterpretq_u64_u32((i & 1)? vzip2q_u32(b[i / 2][0], b[i / 2][1]) : vzip1q_u32(b[i / 2][0], b[i / 2][1]));
+            uint64x2_t t;
+            t = vandq_u64(veorq_u64(x, vshrq_n_u64(x, 7)), vdupq_n_u64(0x00AA00AA00AA00AAULL));
+            x = veorq_u64(veorq_u64(x, t), vshlq_n_u64(t, 7));
+            t = vandq_u64(veorq_u64(x, vshrq_n_u64(x, 14)), vdupq_n_u64(0x0000CCCC0000CCCCULL));
+            x = veorq_u64(veorq_u64(x, t), vshlq_n_u64(t, 14));
+            t = vandq_u64(veorq_u64(x, vshrq_n_u64(x, 28)), vdupq_n_u64(0x00000000F0F0F0F0ULL));
+            x = veorq_u64(veorq_u64(x, t), vshlq_n_u64(t, 28));
+            vst1q_u64(Blocks + Column + i * 2, x);
+        }
+    }
+#endif
+    for (; Column < Count; Column++) {
+        uint64_t x = 0;
+        for (int Row = 0; Row < 8; Row++)
+            x |= (uint64_t)Source[Column + Row * Stride] << (Row * 8);
+        Blocks[Column] = Paint_TransposeBits(x);
+    }
+}
+
+/******************************************************************************
+function: Rotate and mirror a whole 1 bit image into the panel's layout
+parameter:
+    Source : The image as it is seen, Width by Height
+    Width  : The width of Source
+    Height : The height of Source
+    Target : The panel memory, Height by Width for 90 and 270
+    Rotate : 0, 90, 180, 270
+    Mirror : Not mirror,Horizontal mirror,Vertical mirror,Origin mirror
+info:
+    Every pixel lands where Paint_SetPixel would put it drawing into Target
+    set up with that rotation and mirroring, so an image can be drawn upright
+    at one pixel per bit and turned once for the panel. Sizes that are not a
+    multiple of 8 go a pixel at a time. Returns 1 if Rotate or Mirror is not
+    one of the above.
+******************************************************************************/
+UBYTE Paint_TransformImage(const UBYTE *Source, UWORD Width, UWORD Height, UBYTE *Target, UWORD Rotate, UBYTE Mirror)
+{
+    int Orientation = Paint_Orientation(Rotate, Mirror);
+    if (Orientation < 0) {
+        Debug("Paint_TransformImage: rotate = 0, 90, 180, 270 and a known mirror\r\n");
+        return 1;
+    }
+    UBYTE Swap = (Orientation & PAINT_SWAP) != 0;
+    UBYTE FlipX = (Orientation & PAINT_FLIP_X) != 0;
+    UBYTE FlipY = (Orientation & PAINT_FLIP_Y) != 0;
+    UWORD WidthMemory = Swap? Height : Width;
+    UWORD HeightMemory = Swap? Width : Height;
+    UDOUBLE WidthByte = (Width % 8 == 0)? (Width / 8 ): (Width / 8 + 1);
+    UDOUBLE WidthMemoryByte = (WidthMemory % 8 == 0)? (WidthMemory / 8 ): (WidthMemory / 8 + 1);
+
+    if (Width % 8 != 0 || Height % 8 != 0) {
+        memset(Target, 0, WidthMemoryByte * HeightMemory);
+        for (UWORD Y = 0; Y < Height; Y++) {
+            for (UWORD X = 0; X < Width; X++) {
+                if (!(Source[X / 8 + Y * WidthByte] & (0x80 >> (X % 8))))
+                    continue;
+                UWORD TX = Swap? Y : X;
+                UWORD TY = Swap? X : Y;
+                if (FlipX)
+                    TX = WidthMemory - TX - 1;
+                if (FlipY)
+                    TY = HeightMemory - TY - 1;
+                Target[TX / 8 + TY * WidthMemoryByte] |= 0x80 >> (TX % 8);
+            }
+        }
+        return 0;
+    }
+
+    if (!Swap) {
+        //Rows stay rows, a horizontal flip reverses the bytes and the bits in them
+        for (UWORD Y = 0; Y < Height; Y++) {
+            const UBYTE *From = Source + Y * WidthByte;
+            UBYTE *To = Target + (FlipY? HeightMemory - Y - 1 : Y) * WidthMemoryByte;
+            if (!FlipX) {
+                memcpy(To, From, WidthByte);
+                continue;
+            }
+            UDOUBLE Column = 0;
+            for (; Column + 8 <= WidthByte; Column += 8) {
+                uint64_t x;
+                memcpy(&x, From + Column, 8);
+                x = __builtin_bswap64(Paint_ReverseBits(x));
+                memcpy(To + WidthByte - Column - 8, &x, 8);
+            }
+            for (; Column < WidthByte; Column++)
+                To[WidthByte - Column - 1] = (UBYTE)Paint_ReverseBits(From[Column]);
+        }
+        return 0;
+    }
+
+    //Each 8 rows of Source become a column of bytes of Target. The blocks come out
+    //flipped both ways already, so a flip asked for is one not to undo.
+    uint64_t Blocks[16];
+    for (UWORD Band = 0; Band < Height / 8; Band++) {
+        UDOUBLE TargetColumn = FlipX? WidthMemoryByte - Band - 1 : Band;
+        for (UDOUBLE Start = 0; Start < WidthByte; Start += 16) {
+            UWORD Count = (WidthByte - Start < 16)? WidthByte - Start : 16;
+            Paint_TransposeBlocks(Source + Band * 8 * WidthByte + Start, WidthByte, Count, Blocks);
+            for (UWORD Block = 0; Block < Count; Block++) {
+                uint64_t x = FlipX? Blocks[Block] : Paint_ReverseBits(Blocks[Block]);
+                for (int Byte = 0; Byte < 8; Byte++) {
+                    UWORD TY = (Start + Block) * 8 + 7 - Byte;
+                    if (FlipY)
+                        TY = HeightMemory - TY - 1;
+                    Target[TargetColumn + TY * WidthMemoryByte] = (UBYTE)(x >> (Byte * 8));
+                }
+            }
         }
     }
+    return 0;
 }
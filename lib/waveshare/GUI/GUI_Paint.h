@@ -74,9 +74,20 @@
 #include "../Fonts/fonts.h"
 
 /**
- * Image attributes
+ * A changed part of the image in memory coordinates, ends not included
 **/
 typedef struct {
+    UWORD Xstart;
+    UWORD Ystart;
+    UWORD Xend;
+    UWORD Yend;
+} PAINT_RECT;
+#define PAINT_DIRTY_MAX     8
+
+/**
+ * Image attributes
+**/
+typedef struct _tPaint {
     UBYTE *Image;
     UWORD Width;
     UWORD Height;
@@ -88,7 +99,19 @@ typedef struct {
     UWORD WidthByte;
     UWORD HeightByte;
     UWORD Scale;
+    /* Pixel writer for the current rotation, mirroring and scale, picked again by
+       PaintCtx_NewImage, PaintCtx_SetRotate, PaintCtx_SetMirroring and PaintCtx_SetScale */
+    void (*WritePixel)(struct _tPaint *paint, UWORD Xpoint, UWORD Ypoint, UWORD Color);
+    /* What PaintCtx_SetPixel calls: WritePixel itself, or one that marks the pixel dirty first */
+    void (*SetPixel)(struct _tPaint *paint, UWORD Xpoint, UWORD Ypoint, UWORD Color);
+    /* Parts drawn in since tracking was turned on, the image was selected or the list reset.
+       Off after PaintCtx_NewImage, PaintCtx_SetDirtyTracking turns it on. */
+    UBYTE TrackDirty;
+    PAINT_RECT Dirty[PAINT_DIRTY_MAX];
+    UBYTE DirtyCount;
+    PAINT_RECT DirtyHint;   /* Image coordinates of the last one added to, for GUI_Paint.c */
 } PAINT;
+/* The image the Paint_ functions draw into */
 extern PAINT Paint;
 
 /**
@@ -191,6 +214,8 @@ UBYTE Paint_GetPixel(UWORD Xpoint, UWORD Ypoint);
 
 void Paint_Clear(UWORD Color);
 void Paint_ClearWindows(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend, UWORD Color);
+void Paint_FillSpan(UWORD Xstart, UWORD Xend, UWORD Ypoint, UWORD Color);
+void Paint_FillRect(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend, UWORD Color);
 
 //Drawing
 void Paint_DrawPoint(UWORD Xpoint, UWORD Ypoint, UWORD Color, DOT_PIXEL Dot_Pixel, DOT_STYLE Dot_FillWay);
@@ -208,6 +233,54 @@ void Paint_DrawTime(UWORD Xstart, UWORD Ystart, PAINT_TIME *pTime, sFONT* Font,
 
 //pic
 void Paint_DrawBitMap(const unsigned char* image_buffer);
+UBYTE Paint_TransformImage(const UBYTE *Source, UWORD Width, UWORD Height, UBYTE *Target, UWORD Rotate, UBYTE Mirror);
+
+//Partial refresh
+void Paint_SetDirtyTracking(UBYTE Enable);
+UBYTE Paint_GetDirty(PAINT_RECT *Rects);
+void Paint_ResetDirty(void);
+UDOUBLE Paint_CopyRect(const PAINT_RECT *Rect, UBYTE *Target);
+
+/**
+ * The same functions on an explicit PAINT, so threads can draw into images of their own.
+ * A PAINT must not be used by two threads at once.
+**/
+//init and Clear
+void PaintCtx_NewImage(PAINT *paint, UBYTE *image, UWORD Width, UWORD Height, UWORD Rotate, UWORD Color);
+void PaintCtx_SelectImage(PAINT *paint, UBYTE *image);
+void PaintCtx_SetRotate(PAINT *paint, UWORD Rotate);
+void PaintCtx_SetMirroring(PAINT *paint, UBYTE mirror);
+void PaintCtx_SetPixel(PAINT *paint, UWORD Xpoint, UWORD Ypoint, UWORD Color);
+void PaintCtx_SetScale(PAINT *paint, UBYTE scale);
+UBYTE PaintCtx_GetPixel(PAINT *paint, UWORD Xpoint, UWORD Ypoint);
+
+void PaintCtx_Clear(PAINT *paint, UWORD Color);
+void PaintCtx_ClearWindows(PAINT *paint, UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend, UWORD Color);
+void PaintCtx_FillSpan(PAINT *paint, UWORD Xstart, UWORD Xend, UWORD Ypoint, UWORD Color);
+void PaintCtx_FillRect(PAINT *paint, UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend, UWORD Color);
+
+//Drawing
+void PaintCtx_DrawPoint(PAINT *paint, UWORD Xpoint, UWORD Ypoint, UWORD Color, DOT_PIXEL Dot_Pixel, DOT_STYLE Dot_FillWay);
+void PaintCtx_DrawLine(PAINT *paint, UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend, UWORD Color, DOT_PIXEL Line_width, LINE_STYLE Line_Style);
+void PaintCtx_DrawRectangle(PAINT *paint, UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend, UWORD Color, DOT_PIXEL Line_width, DRAW_FILL Draw_Fill);
+void PaintCtx_DrawCircle(PAINT *paint, UWORD X_Center, UWORD Y_Center, UWORD Radius, UWORD Color, DOT_PIXEL Line_width, DRAW_FILL Draw_Fill);
+
+//Display string
+void PaintCtx_DrawChar(PAINT *paint, UWORD Xstart, UWORD Ystart, const char Acsii_Char, sFONT* Font, UWORD Color_Foreground, UWORD Color_Background);
+void PaintCtx_DrawString_EN(PAINT *paint, UWORD Xstart, UWORD Ystart, const char * pString, sFONT* Font, UWORD Color_Foreground, UWORD Color_Background);
+void PaintCtx_DrawString_CN(PAINT *paint, UWORD Xstart, UWORD Ystart, const char * pString, cFONT* font, UWORD Color_Foreground, UWORD Color_Background);
+void PaintCtx_DrawNum(PAINT *paint, UWORD Xpoint, UWORD Ypoint, int32_t Nummber, sFONT* Font, UWORD Color_Foreground, UWORD Color_Background);
+void PaintCtx_DrawNumDecimals(PAINT *paint, UWORD Xpoint, UWORD Ypoint, double Nummber, sFONT* Font, UWORD Digit, UWORD Color_Foreground, UWORD Color_Background);
+void PaintCtx_DrawTime(PAINT *paint, UWORD Xstart, UWORD Ystart, PAINT_TIME *pTime, sFONT* Font, UWORD Color_Foreground, UWORD Color_Background);
+
+//pic
+void PaintCtx_DrawBitMap(PAINT *paint, const unsigned char* image_buffer);
+
+//Partial refresh
+void PaintCtx_SetDirtyTracking(PAINT *paint, UBYTE Enable);
+UBYTE PaintCtx_GetDirty(PAINT *paint, PAINT_RECT *Rects);
+void PaintCtx_ResetDirty(PAINT *paint);
+UDOUBLE PaintCtx_CopyRect(PAINT *paint, const PAINT_RECT *Rect, UBYTE *Target);
 
 
 #endif
@@ -79,6 +79,8 @@ static void EPD_SendData2(UBYTE *pData, UDOUBLE len)
     DEV_Digital_Write(EPD_CS_PIN, 1);
 }
 
+UDOUBLE EPD_7IN5_V2_BusyMs = 0;
+
 /******************************************************************************
 function :	Wait until the busy_pin goes LOW
 parameter:
@@ -88,8 +90,10 @@ static void EPD_WaitUntilIdle(void)
     Debug("e-Paper busy\r\n");
 	do{
 		DEV_Delay_ms(5);  
+		EPD_7IN5_V2_BusyMs += 5;
 	}while(!(DEV_Digital_Read(EPD_BUSY_PIN)));   
 	DEV_Delay_ms(5);      
+	EPD_7IN5_V2_BusyMs += 5;
     Debug("e-Paper busy release\r\n");
 }
 /******************************************************************************
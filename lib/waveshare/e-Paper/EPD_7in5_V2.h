@@ -40,6 +40,9 @@
 #define EPD_7IN5_V2_WIDTH       800
 #define EPD_7IN5_V2_HEIGHT      480
 
+// Milliseconds spent polling BUSY since start up, counted in the 5 ms steps of the poll
+extern UDOUBLE EPD_7IN5_V2_BusyMs;
+
 UBYTE EPD_7IN5_V2_Init(void);
 UBYTE EPD_7IN5_V2_Init_Fast(void);
 UBYTE EPD_7IN5_V2_Init_Part(void);
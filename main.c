@@ -7,11 +7,21 @@
 #include <chrono>
 
 #include "mandelbrot.hpp"
+#include "renderpipeline.hpp"
+#include "tilecache.hpp"
+#include "checkpoint.hpp"
+#include "metrics.hpp"
+#include <functional>
 
 using namespace std;
 using namespace chrono;
 
 static constexpr unsigned long SecondsBetweenImages = 25*60; 
+// Deep zooms render by perturbation so precision is no longer the limit, but the iteration
+// budget keeps growing with depth; start over from the whole set after this many zooms
+static constexpr unsigned int ZoomsBeforeRestart = 150;
+// Every restart goes through the same few views near the root again, so those are kept on disk
+static constexpr size_t TileCacheBytes = 64 << 20;
 void  Handler(int signo)
 {
     //System Exit
@@ -21,8 +31,122 @@ void  Handler(int signo)
     exit(0);
 }
 
-int main(void)
+// Runs one step of a panel update and books its time, with the time spent polling BUSY booked on its own
+static void TimePanelStep(Metrics::Phase phase, const function<void()>& step)
 {
+    UDOUBLE busyBefore = EPD_7IN5_V2_BusyMs;
+    steady_clock::time_point start = steady_clock::now();
+    step();
+    double seconds = duration<double>(steady_clock::now() - start).count();
+    double busy = (EPD_7IN5_V2_BusyMs - busyBefore) / 1000.0;
+    Metrics::AddPhase(phase, max(0.0, seconds - busy));
+    Metrics::AddPhase(Metrics::Phase::PanelBusyWait, busy);
+}
+
+// Renders the initial view once on a single thread and once on the pool,
+// without touching the panel, and prints how much faster the pool was
+static int ReportSpeedup(unsigned int threads)
+{
+    UWORD Imagesize = ((EPD_7IN5_V2_WIDTH % 8 == 0)? (EPD_7IN5_V2_WIDTH / 8 ): (EPD_7IN5_V2_WIDTH / 8 + 1)) * EPD_7IN5_V2_HEIGHT;
+    UBYTE* singleImg = (UBYTE *)malloc(Imagesize);
+    UBYTE* pooledImg = (UBYTE *)malloc(Imagesize);
+    if(singleImg == NULL || pooledImg == NULL) {
+        printf("Failed to apply for image memory...\r\n");
+        return -1;
+    }
+
+    MandelbrotSet single;
+    single.SetThreadCount(1);
+    single.SetRender(singleImg);
+    single.Render(EPD_7IN5_V2_WIDTH, EPD_7IN5_V2_HEIGHT);
+
+    MandelbrotSet pooled;
+    pooled.SetThreadCount(threads);
+    pooled.SetRender(pooledImg);
+    pooled.Render(EPD_7IN5_V2_WIDTH, EPD_7IN5_V2_HEIGHT);
+
+    printf("1 thread: %.1f ms, %u threads: %.1f ms, speedup %.2fx, images %s\r\n",
+        single.GetLastRenderMs(), pooled.GetThreadCount(), pooled.GetLastRenderMs(),
+        single.GetLastRenderMs() / pooled.GetLastRenderMs(),
+        memcmp(singleImg, pooledImg, Imagesize) == 0 ? "identical" : "DIFFER");
+
+    free(singleImg);
+    free(pooledImg);
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    // -t <n> sets the number of render threads (0 = one per core),
+    // --scalar renders with the reference kernel instead of the SIMD one,
+    // --subdivide skips iterating areas enclosed by a border of one class (Mariani-Silver),
+    // --trace only iterates along the boundary between escaped and bounded pixels,
+    // --self-check also renders every frame by brute force and logs the pixels that differ,
+    // --fixed-iterations keeps the iteration budget at the depth heuristic instead of adapting it,
+    // --no-preview renders every zoom in full without checking a low resolution preview first,
+    // --tile-cache <file> keeps views near the root in that file instead of piArtFrame.tiles,
+    // --no-tile-cache renders every view, --cache-iterations also keeps their escape counts,
+    // --checkpoint <file> saves the zoom path there instead of piArtFrame.state,
+    // --cold-start ignores the saved zoom path and begins from the whole set,
+    // --metrics <file> writes phase timings and render counters there in the Prometheus text format,
+    // --rotate <90|180|270> renders upright for a frame hung that way round and turns each image for the panel,
+    // --speedup compares the pool against a single thread and exits
+    unsigned int renderThreads = 0;
+    bool scalarKernel = false;
+    MandelbrotSet::RenderMode renderMode = MandelbrotSet::RenderMode::BruteForce;
+    bool selfCheck = false;
+    bool fixedIterations = false;
+    bool progressive = true;
+    const char* tileCachePath = "piArtFrame.tiles";
+    bool cacheIterations = false;
+    const char* checkpointPath = "piArtFrame.state";
+    bool coldStart = false;
+    const char* metricsPath = NULL;
+    UWORD rotate = ROTATE_0;
+    bool reportSpeedup = false;
+    for(int i = 1; i < argc; ++i) {
+        if(strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            renderThreads = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--scalar") == 0) {
+            scalarKernel = true;
+        } else if(strcmp(argv[i], "--subdivide") == 0) {
+            renderMode = MandelbrotSet::RenderMode::Subdivide;
+        } else if(strcmp(argv[i], "--trace") == 0) {
+            renderMode = MandelbrotSet::RenderMode::Trace;
+        } else if(strcmp(argv[i], "--self-check") == 0) {
+            selfCheck = true;
+        } else if(strcmp(argv[i], "--fixed-iterations") == 0) {
+            fixedIterations = true;
+        } else if(strcmp(argv[i], "--no-preview") == 0) {
+            progressive = false;
+        } else if(strcmp(argv[i], "--tile-cache") == 0 && i + 1 < argc) {
+            tileCachePath = argv[++i];
+        } else if(strcmp(argv[i], "--no-tile-cache") == 0) {
+            tileCachePath = NULL;
+        } else if(strcmp(argv[i], "--cache-iterations") == 0) {
+            cacheIterations = true;
+        } else if(strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) {
+            checkpointPath = argv[++i];
+        } else if(strcmp(argv[i], "--cold-start") == 0) {
+            coldStart = true;
+        } else if(strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+            metricsPath = argv[++i];
+        } else if(strcmp(argv[i], "--rotate") == 0 && i + 1 < argc) {
+            rotate = atoi(argv[++i]);
+            if(rotate != ROTATE_0 && rotate != ROTATE_90 && rotate != ROTATE_180 && rotate != ROTATE_270) {
+                printf("--rotate takes 0, 90, 180 or 270\r\n");
+                return -1;
+            }
+        } else if(strcmp(argv[i], "--speedup") == 0) {
+            reportSpeedup = true;
+        }
+    }
+    if(reportSpeedup) {
+        return ReportSpeedup(renderThreads);
+    }
+
+    Metrics::SetOutput(metricsPath);
+
     // Exception handling:ctrl + c
     signal(SIGINT, Handler);
     
@@ -30,66 +154,91 @@ int main(void)
         return -1;
     }
 
-    printf("e-Paper Init...\r\n");
-    EPD_7IN5_V2_Init();
-    EPD_7IN5_V2_Clear();
-    DEV_Delay_ms(500);
-
-    // Compute image size 
-    UWORD Imagesize = ((EPD_7IN5_V2_WIDTH % 8 == 0)? (EPD_7IN5_V2_WIDTH / 8 ): (EPD_7IN5_V2_WIDTH / 8 + 1)) * EPD_7IN5_V2_HEIGHT;
-    UBYTE* img = NULL;
+    // The panel keeps its image without power, so after a restart with a checkpoint
+    // it still shows the frame the zoom path had got to and isn't cleared
+    Checkpoint saved;
+    bool warmStart = !coldStart && LoadCheckpoint(checkpointPath, saved);
+    if(warmStart) {
+        printf("Resuming at zoom %u from %s, keeping the image on the panel\r\n", saved.numberOfZooms, checkpointPath);
+    } else {
+        printf("e-Paper Init...\r\n");
+        EPD_7IN5_V2_Init();
+        EPD_7IN5_V2_Clear();
+        DEV_Delay_ms(500);
+    }
 
-    // Allocate memory for image
-    if((img = (UBYTE *)malloc(Imagesize)) == NULL) {
-        printf("Failed to apply for image memory...\r\n");
-        return -1;
+    // Rendered the way the frame hangs; a turned frame gets each image turned into panelImg
+    bool portrait = rotate == ROTATE_90 || rotate == ROTATE_270;
+    UWORD renderWidth = portrait ? EPD_7IN5_V2_HEIGHT : EPD_7IN5_V2_WIDTH;
+    UWORD renderHeight = portrait ? EPD_7IN5_V2_WIDTH : EPD_7IN5_V2_HEIGHT;
+    UBYTE* panelImg = NULL;
+    if(rotate != ROTATE_0) {
+        UDOUBLE Imagesize = ((EPD_7IN5_V2_WIDTH % 8 == 0)? (EPD_7IN5_V2_WIDTH / 8 ): (EPD_7IN5_V2_WIDTH / 8 + 1)) * EPD_7IN5_V2_HEIGHT;
+        panelImg = (UBYTE *)malloc(Imagesize);
+        if(panelImg == NULL) {
+            printf("Failed to apply for image memory...\r\n");
+            return -1;
+        }
     }
-    Paint_NewImage(img, EPD_7IN5_V2_WIDTH, EPD_7IN5_V2_HEIGHT, 0, WHITE);
-    Paint_SelectImage(img);
 
     MandelbrotSet mandelbrot;
-    mandelbrot.InitMandelbrotSet();
-    mandelbrot.SetRender(img);
+    mandelbrot.SetThreadCount(renderThreads);
+    mandelbrot.SetKernel(scalarKernel ? MandelbrotSet::Kernel::Scalar : MandelbrotSet::Kernel::Simd);
+    mandelbrot.SetRenderMode(renderMode);
+    mandelbrot.SetSelfCheck(selfCheck);
+    mandelbrot.SetAdaptiveIterations(!fixedIterations);
+    mandelbrot.SetProgressive(progressive);
+    unique_ptr<TileCache> tileCache;
+    if(tileCachePath != NULL) {
+        tileCache.reset(new TileCache(tileCachePath, TileCacheBytes, renderWidth, renderHeight, cacheIterations));
+        mandelbrot.SetTileCache(tileCache.get());
+    }
+
+    // Frame N+1 is zoomed and rendered in the background while frame N is on display
+    RenderPipeline pipeline(mandelbrot, renderWidth, renderHeight, ZoomsBeforeRestart,
+        checkpointPath, warmStart ? &saved : NULL);
 
-    bool isFirstImage = true;
-    unsigned int numberOfZooms = 1;
+    // A warm start replaces the image on the panel when it is due, going by when it was shown.
+    // Without a clock that survives power cuts that time can be off, so it is clamped to the interval.
+    UBYTE* img = NULL;
+    steady_clock::time_point shownAt = steady_clock::now();
+    if(warmStart) {
+        long long shownFor = min<long long>(max<long long>(0, time(NULL) - saved.shownAt), SecondsBetweenImages);
+        shownAt -= seconds(shownFor);
+    } else {
+        img = pipeline.TakeFrame();
+    }
     while(true)
     {
-        steady_clock::time_point beforeRender = steady_clock::now();
-        cout << "Starting render..." << endl;
-        mandelbrot.Render(EPD_7IN5_V2_WIDTH, EPD_7IN5_V2_HEIGHT);
-        cout << "Render complete!" << endl;
-        steady_clock::time_point afterRender = steady_clock::now();
-        
-        if(isFirstImage)
-        {
-            isFirstImage = false;
-        }
-        else
+        if(img != NULL)
         {
-            while(duration_cast<std::chrono::seconds>(afterRender - beforeRender).count() < SecondsBetweenImages)
-            {
-                sleep(5);
-                afterRender = steady_clock::now();
+            cout << "Drawing image..." << endl;
+            UBYTE* shown = img;
+            if(panelImg != NULL) {
+                Paint_TransformImage(img, renderWidth, renderHeight, panelImg, rotate, MIRROR_NONE);
+                shown = panelImg;
             }
-        }
-        cout << "Drawing image..." << endl;
 
-        EPD_7IN5_V2_Init();
-        EPD_7IN5_V2_Clear();
-        DEV_Delay_ms(500);
-        EPD_7IN5_V2_Display(img);
-        EPD_7IN5_V2_Sleep();
-        cout << "Draw completed!" << endl;
-
-        mandelbrot.ZoomOnInterestingArea();
+            TimePanelStep(Metrics::Phase::PanelInit, [] { EPD_7IN5_V2_Init(); });
+            TimePanelStep(Metrics::Phase::PanelClear, [] { EPD_7IN5_V2_Clear(); });
+            DEV_Delay_ms(500);
+            TimePanelStep(Metrics::Phase::PanelDisplay, [shown] { EPD_7IN5_V2_Display(shown); });
+            TimePanelStep(Metrics::Phase::PanelSleep, [] { EPD_7IN5_V2_Sleep(); });
+            Metrics::Flush();
+            cout << "Draw completed!" << endl;
+            shownAt = steady_clock::now();
+        }
 
-        if(numberOfZooms %50 == 0)
+        // A render that outlasts the interval leaves the current image up until it's done
+        steady_clock::time_point deadline = shownAt + seconds(SecondsBetweenImages);
+        img = pipeline.TakeFrame(deadline);
+        if(img == NULL)
         {
-            mandelbrot.InitMandelbrotSet();
+            printf("Next frame not ready after %lu s, keeping the current image\r\n", SecondsBetweenImages);
+            img = pipeline.TakeFrame();
+            printf("Next frame overran the interval by %lld s\r\n",
+                (long long)duration_cast<seconds>(steady_clock::now() - deadline).count());
         }
-        numberOfZooms++;
-
     }
 
     return 0;
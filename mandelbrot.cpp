@@ -1,21 +1,76 @@
 #include "mandelbrot.hpp"
-#include "GUI_Paint.h"
+#include "escapetime.hpp"
 #include <algorithm>
 #include <cmath>
 #include <vector>
 #include <tuple>
 #include <random>
+#include <chrono>
+#include <mutex>
+#include <cstring>
 
 using namespace std;
-void MandelbrotSet::InitMandelbrotSet()
+using namespace chrono;
+
+MandelbrotSet::MandelbrotSet()
 {
-    w = 4;
-    h = 2;
-    x = -1;
-    y = 0;
     rendered = NULL;
     renderedResX = 0;
     renderedResY = 0;
+    threadCount = 0;
+    kernel = Kernel::Simd;
+    mode = RenderMode::BruteForce;
+    selfCheck = false;
+    recordFrame = false;
+    reuseParent = false;
+    parentResX = 0;
+    parentResY = 0;
+    adaptiveIterations = true;
+    progressive = true;
+    tileCache = NULL;
+    randomSeed = random_device()();
+    randomDraws = 0;
+    budgetScale = 1;
+    lastRenderMs = 0;
+    packMs = 0;
+    renderX = 0;
+    renderY = 0;
+    renderXX = {0, 0};
+    renderYY = {0, 0};
+    precision = Precision::Double;
+    InitMandelbrotSet();
+}
+
+void MandelbrotSet::InitMandelbrotSet()
+{
+    w = 4;
+    h = 2;
+    x = BigFixed(-1.0);
+    y = BigFixed(0.0);
+    budgetScale = 1;
+    zoomAlternatives.clear();
+    zoomLevel = 0;
+    zoomPath = 0;
+}
+
+MandelbrotSet::ViewState MandelbrotSet::GetViewState()
+{
+    return ViewState{x, y, w, h, zoomLevel, zoomPath, zoomDirection, zoomAlternatives, budgetScale, randomSeed, randomDraws};
+}
+
+void MandelbrotSet::SetViewState(const ViewState& state)
+{
+    x = state.x;
+    y = state.y;
+    w = state.w;
+    h = state.h;
+    zoomLevel = state.zoomLevel;
+    zoomPath = state.zoomPath;
+    zoomDirection = state.zoomDirection;
+    zoomAlternatives = state.zoomAlternatives;
+    budgetScale = state.budgetScale;
+    randomSeed = state.randomSeed;
+    randomDraws = state.randomDraws;
 }
 
 void MandelbrotSet::SetRender(UBYTE* image)
@@ -23,63 +78,898 @@ void MandelbrotSet::SetRender(UBYTE* image)
     rendered = image;
 }
 
+void MandelbrotSet::SetThreadCount(unsigned int threads)
+{
+    if(pool && threads == threadCount)
+        return;
+
+    threadCount = threads;
+    pool.reset();
+}
+
+unsigned int MandelbrotSet::GetThreadCount()
+{
+    if(!pool)
+    {
+        pool.reset(new WorkStealingPool(threadCount));
+    }
+    return pool->GetThreadCount();
+}
+
 void MandelbrotSet::Render(UWORD xResolution, UWORD yResolution)
 {
-    // Approximation for number of iterations
-    int iter = (50 + max(0.0, -log10(w)) * 100 );
-    vector<vector<bool>> columns;
+    steady_clock::time_point start = steady_clock::now();
 
-    for(int i = yResolution-1; i>=0; --i)
+    // The view takes the orientation of the render, so a portrait frame isn't squashed into the landscape window
+    if((xResolution < yResolution) != (w < h))
     {
-        vector<bool> rows;
-        for(int j = 0; j < xResolution; ++j)
-        {
-            double p_x = this->x - this->w / 2.0 + (double)j / (double)xResolution * this->w;
-            double p_y = this->y - this->h / 2.0 + (double)(i+1) / (double)yResolution * this->h;
-            rows.emplace_back(IsMandelPoint(p_x, p_y, iter));
-        }
-        columns.emplace_back(rows);
+        swap(w, h);
     }
 
+    // Approximation for number of iterations, scaled by what recent frames' escape counts asked for
+    // and capped so every escape count fits the iteration buffer
+    int fixedIter = (50 + max(0.0, -log10(max(w, h))) * 100 );
+    int iter = adaptiveIterations ? (int)(fixedIter * budgetScale) : fixedIter;
+    iter = max(1, min(iter, (int)MaxStoredIterations));
+
     renderedResX = xResolution;
     renderedResY = yResolution;
+    if(tileCache != NULL && zoomLevel <= TileCache::MaxLevel && LoadCachedView(iter))
+    {
+        lastRenderMs = duration<double, milli>(steady_clock::now() - start).count();
+        return;
+    }
 
-    // Update rendered image
-    for(unsigned int y = 0; y < columns.size(); ++y)
+    // The frame just shown becomes the parent of this one
+    swap(columnX, parentColumnX);
+    swap(rowY, parentRowY);
+    swap(iterationBuffer, parentIterationBuffer);
+    swap(pixelOrbits, parentOrbits);
+    bool parentRecorded = recordFrame && parentResX == xResolution && parentResY == yResolution;
+
+    // Tiles are a multiple of 8 pixels wide, so no two threads ever share a byte of the image.
+    // Interior pixels cost the full iteration budget while escaped ones are cheap,
+    // so the tiles are handed out through a work stealing pool rather than split evenly.
+    unsigned int tiles = ((xResolution + TileSize - 1) / TileSize) * ((yResolution + TileSize - 1) / TileSize);
+    GetThreadCount();
+    auto runPass = [this, iter, tiles](UWORD stride, UWORD previousStride)
     {
-        auto row = columns[y];
-        for(unsigned int x = 0; x < row.size(); ++x)
+        pool->Run(tiles, [this, iter, stride, previousStride](unsigned int, unsigned int tile)
         {
-            auto bitSet = row[x];
-            if(bitSet)
+            RenderTile(tile, iter, stride, previousStride);
+        });
+    };
+
+    // A progressive frame is iterated on every 8th and then every 4th pixel first. When even the finer
+    // preview is almost all one colour, the view moves to the next quadrant the zoom ranked, and
+    // once they have all been tried to the least uniform of them, which is rendered from scratch.
+    // Otherwise the full pass only iterates the pixels the preview didn't.
+    vector<pair<pair<int, int>, double>> tried;
+    bool settled = !progressive || mode != RenderMode::BruteForce;
+    UWORD previewStride = 0;
+    for(;;)
+    {
+        PrepareFrame(iter, parentRecorded);
+        frameStats = EscapeStats();
+        packMs = 0;
+        if(settled)
+            break;
+
+        runPass(8, 0);
+        previewStride = 8;
+        double uniformness = GetPreviewUniformness(8);
+        if(uniformness >= PreviewUniformLimit)
+        {
+            runPass(4, 8);
+            previewStride = 4;
+            uniformness = GetPreviewUniformness(4);
+        }
+        if(uniformness < PreviewUniformLimit || (zoomAlternatives.empty() && tried.empty()))
+            break;
+
+        tried.emplace_back(zoomDirection, uniformness);
+        pair<int, int> next;
+        if(!zoomAlternatives.empty())
+        {
+            next = zoomAlternatives.front();
+            zoomAlternatives.erase(zoomAlternatives.begin());
+        }
+        else
+        {
+            next = min_element(tried.begin(), tried.end(),
+                [](const pair<pair<int, int>, double>& a, const pair<pair<int, int>, double>& b) { return a.second < b.second; })->first;
+            settled = true;
+            // The preview grid still holds the last quadrant tried, not this one
+            previewStride = 0;
+        }
+        printf("Preview is %.1f%% one colour, moving to the (%d, %d) quadrant instead\r\n",
+            100.0 * uniformness, next.first, next.second);
+        MoveCentre(next.first - zoomDirection.first, next.second - zoomDirection.second);
+        zoomDirection = next;
+        zoomPath = (zoomPath & ~3ULL) | QuadrantBits(next);
+    }
+    zoomAlternatives.clear();
+    runPass(1, previewStride);
+    parentResX = xResolution;
+    parentResY = yResolution;
+    if(adaptiveIterations)
+    {
+        AdaptIterationBudget(iter, fixedIter, start);
+    }
+
+    // Lets the zoom score any window of the frame in constant time
+    BuildWhiteSums();
+
+    if(tileCache != NULL && zoomLevel <= TileCache::MaxLevel)
+    {
+        tileCache->Store(GetCacheKey(iter), rendered, iterationBuffer.data(), budgetScale);
+        printf("Tile cache: level %u view stored, %llu hits, %llu misses, %llu evictions\r\n", zoomLevel,
+            tileCache->GetHits(), tileCache->GetMisses(), tileCache->GetEvictions());
+    }
+
+    lastRenderMs = duration<double, milli>(steady_clock::now() - start).count();
+    const char* kernelName = kernel == Kernel::Simd ? EscapeTimeIsa() : "scalar";
+    if(precision == Precision::DoubleDouble)
+        kernelName = "double-double";
+    else if(precision == Precision::Perturbation)
+        kernelName = "perturbation";
+    printf("Rendered %dx%d in %.1f ms on %u threads (%s kernel)\r\n", xResolution, yResolution, lastRenderMs,
+        pool->GetThreadCount(), kernelName);
+
+    auto skipped = frameStats.skippedInterior + frameStats.skippedPeriodic;
+    printf("Iterations: %llu run, %llu skipped inside cardioid/bulb, %llu skipped as periodic (%.1f%% saved)\r\n",
+        frameStats.iterations, frameStats.skippedInterior, frameStats.skippedPeriodic,
+        100.0 * skipped / max(1ULL, frameStats.iterations + skipped));
+    if(reuseParent)
+    {
+        printf("Previous frame: %llu pixels reused, %llu iterations carried over (%.1f%% of the work)\r\n",
+            frameStats.reusedPixels, frameStats.reusedIterations,
+            100.0 * frameStats.reusedIterations / max(1ULL, frameStats.iterations + frameStats.reusedIterations));
+    }
+    if(mode != RenderMode::BruteForce)
+    {
+        unsigned int total = (unsigned int)xResolution * yResolution;
+        printf("%s iterated %llu of %u pixels (%.1f%%, brute force iterates all of them)\r\n",
+            mode == RenderMode::Subdivide ? "Subdivision" : "Boundary tracing",
+            frameStats.pixels, total, 100.0 * frameStats.pixels / max(1u, total));
+
+        if(selfCheck)
+        {
+            unsigned long long mismatched = CountMismatchedPixels(iter);
+            printf("Self check: %llu pixels differ from brute force\r\n", mismatched);
+        }
+    }
+    printf("Packing output took %.2f ms over all threads\r\n", packMs);
+    if(precision == Precision::Perturbation)
+    {
+        printf("Perturbation: %u point reference orbit at %u bits, %llu rebases\r\n",
+            reference.GetLength(), 32 * x.GetFractionLimbs(), frameStats.rebases);
+    }
+}
+
+void MandelbrotSet::PrepareFrame(int iterations, bool parentRecorded)
+{
+    renderX = x.ToDouble();
+    renderY = y.ToDouble();
+
+    // Past double precision, iterate every pixel in double-double. Past that as well, iterate one
+    // reference orbit at full precision and every pixel as a double precision difference from it.
+    // The finer of the two pixel spacings decides, the view isn't exactly the shape of the render.
+    double spacing = min(w / renderedResX, h / renderedResY) / max(1.0, max(fabs(renderX), fabs(renderY)));
+    if(spacing >= DoubleDoubleSpacing)
+    {
+        precision = Precision::Double;
+    }
+    else if(spacing >= PerturbationSpacing)
+    {
+        precision = Precision::DoubleDouble;
+        renderXX = ToDoubleDouble(x);
+        renderYY = ToDoubleDouble(y);
+    }
+    else
+    {
+        precision = Precision::Perturbation;
+        reference.Compute(x, y, iterations + 2);
+    }
+
+    MapCoordinates();
+
+    // Only the plain double SIMD kernel stores its orbits, and pixels can only be carried over
+    // when the coordinates match bit for bit, so every precision and mode change starts afresh
+    recordFrame = precision == Precision::Double && kernel == Kernel::Simd && mode == RenderMode::BruteForce;
+    reuseParent = recordFrame && parentRecorded && MatchParentPixels();
+    iterationBuffer.resize((UDOUBLE)renderedResX * renderedResY);
+    if(recordFrame)
+    {
+        pixelOrbits.resize((UDOUBLE)renderedResX * renderedResY);
+    }
+}
+
+TileCache::Key MandelbrotSet::GetCacheKey(int iterations)
+{
+    // FNV-1a over whatever else changes the pixels of a view
+    uint64_t params = 14695981039346656037ULL;
+    for(uint32_t value : {(uint32_t)renderedResX, (uint32_t)renderedResY, (uint32_t)iterations, (uint32_t)mode})
+    {
+        for(int byte = 0; byte < 4; ++byte)
+        {
+            params = (params ^ ((value >> (8 * byte)) & 0xFF)) * 1099511628211ULL;
+        }
+    }
+    return TileCache::Key{zoomLevel, zoomPath, params};
+}
+
+bool MandelbrotSet::LoadCachedView(int iterations)
+{
+    UDOUBLE total = (UDOUBLE)renderedResX * renderedResY;
+    iterationBuffer.resize(total);
+    double scale = budgetScale;
+    bool hasIterations = false;
+    if(!tileCache->Lookup(GetCacheKey(iterations), rendered, iterationBuffer.data(), scale, hasIterations))
+        return false;
+
+    // Without stored escape counts the image is all there is: escaped pixels count as filled
+    if(!hasIterations)
+    {
+        UWORD widthByte = (renderedResX % 8 == 0) ? (renderedResX / 8) : (renderedResX / 8 + 1);
+        for(UWORD row = 0; row < renderedResY; ++row)
+        {
+            const UBYTE* in = rendered + (UDOUBLE)row * widthByte;
+            uint16_t* counts = iterationBuffer.data() + (UDOUBLE)row * renderedResX;
+            for(UWORD j = 0; j < renderedResX; ++j)
+            {
+                counts[j] = (in[j / 8] >> (7 - j % 8)) & 1 ? FilledIterations : InteriorIterations;
+            }
+        }
+    }
+
+    // Nothing of the view's orbits is kept, so the next frame can't build on it
+    recordFrame = false;
+    reuseParent = false;
+    zoomAlternatives.clear();
+    frameStats = EscapeStats();
+    if(adaptiveIterations)
+    {
+        budgetScale = scale;
+    }
+    BuildWhiteSums();
+    printf("Tile cache: level %u view found, %llu hits, %llu misses, %llu evictions\r\n", zoomLevel,
+        tileCache->GetHits(), tileCache->GetMisses(), tileCache->GetEvictions());
+    return true;
+}
+
+double MandelbrotSet::GetPreviewUniformness(UWORD stride)
+{
+    unsigned int white = 0;
+    unsigned int total = 0;
+    for(UWORD row = 0; row < renderedResY; row += stride)
+    {
+        const uint16_t* counts = iterationBuffer.data() + (UDOUBLE)row * renderedResX;
+        for(UWORD j = 0; j < renderedResX; j += stride)
+        {
+            white += counts[j] != InteriorIterations;
+            ++total;
+        }
+    }
+    return max(white, total - white) / (double)max(1u, total);
+}
+
+void MandelbrotSet::MapCoordinates()
+{
+    // The tables only grow, so a frame at the usual resolution doesn't touch the heap
+    columnX.resize(renderedResX);
+    rowY.resize(renderedResY);
+
+    // With a non-double precision these are offsets from the view centre,
+    // which is the reference point when perturbing
+    double originX = precision == Precision::Double ? renderX : 0.0;
+    double originY = precision == Precision::Double ? renderY : 0.0;
+
+    for(UWORD j = 0; j < renderedResX; ++j)
+    {
+        columnX[j] = originX - this->w / 2.0 + (double)j / (double)renderedResX * this->w;
+    }
+    for(UWORD row = 0; row < renderedResY; ++row)
+    {
+        // Row 0 is the top of the image, i.e. the largest imaginary part
+        int i = renderedResY - 1 - row;
+        rowY[row] = originY - this->h / 2.0 + (double)(i+1) / (double)renderedResY * this->h;
+    }
+
+    if(precision == Precision::DoubleDouble)
+    {
+        // The offsets are small enough for doubles, only the sum with the centre needs the extra bits
+        columnXX.resize(renderedResX);
+        rowYY.resize(renderedResY);
+        for(UWORD j = 0; j < renderedResX; ++j)
+        {
+            columnXX[j] = renderXX + DoubleDouble{columnX[j], 0};
+        }
+        for(UWORD row = 0; row < renderedResY; ++row)
+        {
+            rowYY[row] = renderYY + DoubleDouble{rowY[row], 0};
+        }
+    }
+}
+
+void MandelbrotSet::RenderTile(unsigned int tile, int iterations, UWORD stride, UWORD previousStride)
+{
+    unsigned int tilesX = (renderedResX + TileSize - 1) / TileSize;
+    Tile t;
+    t.xStart = (tile % tilesX) * TileSize;
+    t.yStart = (tile / tilesX) * TileSize;
+    t.width = min<UWORD>(TileSize, renderedResX - t.xStart);
+    t.height = min<UWORD>(TileSize, renderedResY - t.yStart);
+    t.iterations = iterations;
+    t.stride = stride;
+    t.previousStride = previousStride;
+    unsigned int count = t.width * t.height;
+
+    if(recordFrame)
+    {
+        EvaluateTileRecorded(t);
+    }
+    else if(mode == RenderMode::Subdivide || mode == RenderMode::Trace)
+    {
+        memset(t.classes, Unknown, count);
+        memset(t.evaluated, 0, count);
+        if(mode == RenderMode::Subdivide)
+            SubdivideRect(t, 0, 0, t.width, t.height);
+        else
+            TraceTile(t);
+
+        // Pixels filled rather than iterated have no escape count of their own
+        for(unsigned int p = 0; p < count; ++p)
+        {
+            uint16_t& stored = iterationBuffer[(UDOUBLE)(t.yStart + p / t.width) * renderedResX + t.xStart + p % t.width];
+            if(t.classes[p] == Bounded)
+                stored = InteriorIterations;
+            else if(!t.evaluated[p])
+                stored = FilledIterations;
+        }
+    }
+    else
+    {
+        UWORD pixels[TileSize * TileSize];
+        unsigned int pending = 0;
+        for(unsigned int p = 0; p < count; ++p)
+        {
+            if(InPass(t, t.xStart + p % t.width, t.yStart + p / t.width))
+                pixels[pending++] = p;
+        }
+        EvaluatePixels(t, pixels, pending);
+    }
+
+    // The image only needs packing once every pixel of the tile is in
+    double tilePackMs = 0;
+    if(stride == 1)
+    {
+        steady_clock::time_point packStart = steady_clock::now();
+        ThresholdTile(t);
+        tilePackMs = duration<double, milli>(steady_clock::now() - packStart).count();
+    }
+
+    lock_guard<mutex> guard(statsLock);
+    frameStats.Add(t.stats);
+    packMs += tilePackMs;
+}
+
+void MandelbrotSet::ThresholdTile(const Tile& t)
+{
+    // Threshold pass from the iteration buffer: everything but the interior is white.
+    // Tiles start on a byte boundary, so whole bytes are assembled and stored without reading the image.
+    // Bits past the right edge of the image are left clear.
+    UWORD widthByte = (renderedResX % 8 == 0) ? (renderedResX / 8) : (renderedResX / 8 + 1);
+    for(UWORD row = t.yStart; row < t.yStart + t.height; ++row)
+    {
+        const uint16_t* counts = iterationBuffer.data() + (UDOUBLE)row * renderedResX + t.xStart;
+        UBYTE* out = rendered + (UDOUBLE)row * widthByte + t.xStart / 8;
+        for(UWORD j = 0; j < t.width; j += 8)
+        {
+            UWORD bits = min<UWORD>(8, t.width - j);
+            UBYTE packed = 0;
+            for(UWORD b = 0; b < bits; ++b)
             {
-                Paint_SetPixel(x, y, WHITE);
+                packed |= (counts[j + b] != InteriorIterations) << (7 - b);
             }
-            else
+            *out++ = packed;
+        }
+    }
+}
+
+void MandelbrotSet::EvaluatePixels(Tile& tile, const UWORD* pixels, unsigned int count)
+{
+    int escapedAt[TileSize * TileSize];
+    if(precision == Precision::DoubleDouble)
+    {
+        DoubleDouble cx[TileSize * TileSize];
+        DoubleDouble cy[TileSize * TileSize];
+        GatherPixels(columnXX.data(), rowYY.data(), tile, pixels, count, cx, cy);
+        DoubleDoubleBatch(cx, cy, count, tile.iterations, escapedAt, tile.stats);
+    }
+    else
+    {
+        double cx[TileSize * TileSize];
+        double cy[TileSize * TileSize];
+        GatherPixels(columnX.data(), rowY.data(), tile, pixels, count, cx, cy);
+
+        if(precision == Precision::Perturbation)
+        {
+            PerturbationBatch(reference, renderX, renderY, cx, cy, count, tile.iterations, escapedAt, tile.stats);
+        }
+        else if(kernel == Kernel::Simd)
+        {
+            EscapeTimeBatch(cx, cy, count, tile.iterations, escapedAt, tile.stats);
+        }
+        else
+        {
+            for(unsigned int p = 0; p < count; ++p)
             {
-                Paint_SetPixel(x, y, BLACK);
+                escapedAt[p] = GetEscapeIteration(cx[p], cy[p], tile.iterations, tile.stats);
             }
         }
     }
+
+    for(unsigned int p = 0; p < count; ++p)
+    {
+        tile.classes[pixels[p]] = escapedAt[p] < tile.iterations ? Escaped : Bounded;
+        tile.evaluated[pixels[p]] = true;
+        iterationBuffer[(UDOUBLE)(tile.yStart + pixels[p] / tile.width) * renderedResX + tile.xStart + pixels[p] % tile.width] =
+            StoredIterations(escapedAt[p], tile.iterations);
+    }
+    tile.stats.pixels += count;
 }
 
-bool MandelbrotSet::IsMandelPoint(double fX, double fY, int iterations)
+void MandelbrotSet::AdaptIterationBudget(int iterations, int fixedIterations, steady_clock::time_point start)
 {
+    unsigned int total = (unsigned int)renderedResX * renderedResY;
+    unsigned int tilesX = (renderedResX + TileSize - 1) / TileSize;
+    unsigned int tilesY = (renderedResY + TileSize - 1) / TileSize;
+
+    // Many escapes just under the cap mean more are hiding behind it. With stored orbits the
+    // unresolved pixels carry on to a doubled budget, without starting the frame over.
+    int budget = iterations;
+    unsigned long long deepenedPixels = 0;
+    double nearCap = CountEscapesFrom(budget - budget / 4) / (double)total;
+    for(int round = 0; recordFrame && round < MaxDeepenRounds && nearCap > DeepenNearCap; ++round)
+    {
+        int from = budget;
+        budget = min(min(2 * budget, (int)(fixedIterations * MaxBudgetScale)), (int)MaxStoredIterations);
+        if(budget == from)
+            break;
+
+        EscapeStats before = frameStats;
+        pool->Run(tilesX * tilesY, [this, budget](unsigned int, unsigned int tile) { DeepenTile(tile, budget); });
+        deepenedPixels += frameStats.pixels - before.pixels;
+        nearCap = CountEscapesFrom(budget - budget / 4) / (double)total;
+    }
+
+    // Pixels that used the whole budget are what a different budget would have cost more or less of
+    unsigned long long capped = 0;
+    for(UDOUBLE p = 0; p < total; ++p)
+    {
+        if(iterationBuffer[p] == InteriorIterations && (!recordFrame || pixelOrbits[p].count >= 0))
+            ++capped;
+    }
+    if(!recordFrame)
+        capped -= min(capped, frameStats.skippedInterior / max(iterations, 1));
+    double msPerIteration = duration<double, milli>(steady_clock::now() - start).count()
+        / max(1ULL, frameStats.iterations);
+    double savedMs = (double)capped * (fixedIterations - budget) * msPerIteration;
+
+    printf("Iteration budget %d (fixed heuristic %d), %.3f%% of pixels escaped in the top quarter",
+        budget, fixedIterations, 100.0 * nearCap);
+    if(budget != iterations)
+        printf(", %llu unresolved pixels deepened from %d", deepenedPixels, iterations);
+    printf(", about %.0f ms %s than the fixed budget\r\n", fabs(savedMs), savedMs >= 0 ? "less" : "more");
+
+    // Steer the next frame's budget relative to the heuristic for its depth
+    if(nearCap > NearCapTarget)
+        budgetScale = min(budgetScale * 1.25, MaxBudgetScale);
+    else if(nearCap < NearCapTarget / 8)
+        budgetScale = max(budgetScale * 0.85, MinBudgetScale);
+}
+
+unsigned int MandelbrotSet::CountEscapesFrom(int iteration)
+{
+    unsigned int escapes = 0;
+    for(uint16_t count : iterationBuffer)
+    {
+        escapes += count >= iteration && count < FilledIterations;
+    }
+    return escapes;
+}
+
+void MandelbrotSet::DeepenTile(unsigned int tile, int iterations)
+{
+    unsigned int tilesX = (renderedResX + TileSize - 1) / TileSize;
+    Tile t;
+    t.xStart = (tile % tilesX) * TileSize;
+    t.yStart = (tile / tilesX) * TileSize;
+    t.width = min<UWORD>(TileSize, renderedResX - t.xStart);
+    t.height = min<UWORD>(TileSize, renderedResY - t.yStart);
+    t.iterations = iterations;
+
+    double cx[TileSize * TileSize];
+    double cy[TileSize * TileSize];
+    OrbitState orbits[TileSize * TileSize];
+    int escapedAt[TileSize * TileSize];
+    UDOUBLE pending[TileSize * TileSize];
+    unsigned int count = 0;
+    for(UWORD row = t.yStart; row < t.yStart + t.height; ++row)
+    {
+        for(UWORD j = t.xStart; j < t.xStart + t.width; ++j)
+        {
+            UDOUBLE pixel = (UDOUBLE)row * renderedResX + j;
+            if(iterationBuffer[pixel] != InteriorIterations || pixelOrbits[pixel].count <= 0)
+                continue;
+            cx[count] = columnX[j];
+            cy[count] = rowY[row];
+            orbits[count] = pixelOrbits[pixel];
+            pending[count++] = pixel;
+        }
+    }
+    if(count == 0)
+        return;
+
+    EscapeTimeBatch(cx, cy, count, iterations, escapedAt, t.stats, orbits);
+    t.stats.pixels += count;
+    for(unsigned int k = 0; k < count; ++k)
+    {
+        iterationBuffer[pending[k]] = StoredIterations(escapedAt[k], iterations);
+        pixelOrbits[pending[k]] = orbits[k];
+    }
+    ThresholdTile(t);
+
+    lock_guard<mutex> guard(statsLock);
+    frameStats.Add(t.stats);
+}
+
+bool MandelbrotSet::MatchParentPixels()
+{
+    // After a 2x zoom every other column and row lands exactly on one of the parent's;
+    // anything that doesn't compare equal is iterated from scratch
+    parentColumn.resize(renderedResX);
+    parentRow.resize(renderedResY);
+    bool any = false;
+    for(UWORD j = 0; j < renderedResX; ++j)
+    {
+        auto match = lower_bound(parentColumnX.begin(), parentColumnX.end(), columnX[j]);
+        parentColumn[j] = (match != parentColumnX.end() && *match == columnX[j]) ? match - parentColumnX.begin() : -1;
+        any |= parentColumn[j] >= 0;
+    }
+    for(UWORD row = 0; row < renderedResY; ++row)
+    {
+        // Rows run from the top, i.e. in decreasing imaginary part
+        auto match = lower_bound(parentRowY.begin(), parentRowY.end(), rowY[row], greater<double>());
+        parentRow[row] = (match != parentRowY.end() && *match == rowY[row]) ? match - parentRowY.begin() : -1;
+        any |= parentRow[row] >= 0;
+    }
+    return any;
+}
+
+void MandelbrotSet::EvaluateTileRecorded(Tile& tile)
+{
+    double cx[TileSize * TileSize];
+    double cy[TileSize * TileSize];
+    OrbitState orbits[TileSize * TileSize];
+    int escapedAt[TileSize * TileSize];
+    UWORD pending[TileSize * TileSize];
+    unsigned int count = 0;
+
+    for(UWORD p = 0; p < tile.width * tile.height; ++p)
+    {
+        UWORD j = tile.xStart + p % tile.width;
+        UWORD row = tile.yStart + p / tile.width;
+        UDOUBLE pixel = (UDOUBLE)row * renderedResX + j;
+        if(!InPass(tile, j, row))
+            continue;
+
+        orbits[count].count = 0;
+        if(reuseParent && parentColumn[j] >= 0 && parentRow[row] >= 0)
+        {
+            // Same point: an escape within this frame's budget is final, a proven interior point
+            // stays inside, anything else carries on where the parent stopped. The budget can
+            // shrink between frames, so a later escape is iterated again and a longer orbit is cut short.
+            UDOUBLE parent = (UDOUBLE)parentRow[row] * renderedResX + parentColumn[j];
+            const OrbitState& orbit = parentOrbits[parent];
+            uint16_t parentCount = parentIterationBuffer[parent];
+            if(parentCount != InteriorIterations && parentCount < tile.iterations)
+            {
+                iterationBuffer[pixel] = parentCount;
+                ++tile.stats.reusedPixels;
+                tile.stats.reusedIterations += parentCount + 1;
+                continue;
+            }
+            if(parentCount == InteriorIterations && (orbit.count < 0 || orbit.count >= tile.iterations))
+            {
+                iterationBuffer[pixel] = InteriorIterations;
+                pixelOrbits[pixel] = orbit;
+                ++tile.stats.reusedPixels;
+                tile.stats.reusedIterations += max(orbit.count, 0);
+                continue;
+            }
+            if(parentCount == InteriorIterations)
+            {
+                orbits[count] = orbit;
+                ++tile.stats.reusedPixels;
+                tile.stats.reusedIterations += orbit.count;
+            }
+        }
+
+        cx[count] = columnX[j];
+        cy[count] = rowY[row];
+        pending[count++] = p;
+    }
+
+    if(count == 0)
+        return;
+    EscapeTimeBatch(cx, cy, count, tile.iterations, escapedAt, tile.stats, orbits);
+    tile.stats.pixels += count;
+
+    for(unsigned int k = 0; k < count; ++k)
+    {
+        UDOUBLE pixel = (UDOUBLE)(tile.yStart + pending[k] / tile.width) * renderedResX + tile.xStart + pending[k] % tile.width;
+        iterationBuffer[pixel] = StoredIterations(escapedAt[k], tile.iterations);
+        pixelOrbits[pixel] = orbits[k];
+    }
+}
+
+void MandelbrotSet::SubdivideRect(Tile& tile, UWORD x0, UWORD y0, UWORD x1, UWORD y1)
+{
+    // Border pixels, each once even when the rectangle is a single row or column
+    UWORD border[4 * TileSize];
+    unsigned int borderCount = 0;
+    for(UWORD x = x0; x < x1; ++x)
+    {
+        border[borderCount++] = y0 * tile.width + x;
+        if(y1 - 1 > y0)
+            border[borderCount++] = (y1 - 1) * tile.width + x;
+    }
+    for(UWORD y = y0 + 1; y + 1 < y1; ++y)
+    {
+        border[borderCount++] = y * tile.width + x0;
+        if(x1 - 1 > x0)
+            border[borderCount++] = y * tile.width + x1 - 1;
+    }
+
+    // Neighbouring rectangles share their edges, so some of the border may already be known
+    UWORD pending[4 * TileSize];
+    unsigned int pendingCount = 0;
+    for(unsigned int p = 0; p < borderCount; ++p)
+    {
+        if(tile.classes[border[p]] == Unknown)
+            pending[pendingCount++] = border[p];
+    }
+    if(pendingCount > 0)
+        EvaluatePixels(tile, pending, pendingCount);
+
+    UBYTE first = tile.classes[border[0]];
+    bool uniform = true;
+    for(unsigned int p = 1; p < borderCount && uniform; ++p)
+    {
+        uniform = tile.classes[border[p]] == first;
+    }
+
+    if(uniform)
+    {
+        for(UWORD y = y0 + 1; y + 1 < y1; ++y)
+        {
+            if(x1 - x0 > 2)
+                memset(tile.classes + y * tile.width + x0 + 1, first, x1 - x0 - 2);
+        }
+        return;
+    }
+
+    if(x1 - x0 <= SubdivideMinSize || y1 - y0 <= SubdivideMinSize)
+    {
+        UWORD inside[TileSize * TileSize];
+        unsigned int insideCount = 0;
+        for(UWORD y = y0 + 1; y + 1 < y1; ++y)
+        {
+            for(UWORD x = x0 + 1; x + 1 < x1; ++x)
+            {
+                inside[insideCount++] = y * tile.width + x;
+            }
+        }
+        EvaluatePixels(tile, inside, insideCount);
+        return;
+    }
+
+    // Quarters overlap on the middle row and column, which are then iterated only once
+    UWORD xMid = (x0 + x1) / 2;
+    UWORD yMid = (y0 + y1) / 2;
+    SubdivideRect(tile, x0, y0, xMid + 1, yMid + 1);
+    SubdivideRect(tile, xMid, y0, x1, yMid + 1);
+    SubdivideRect(tile, x0, yMid, xMid + 1, y1);
+    SubdivideRect(tile, xMid, yMid, x1, y1);
+}
+
+void MandelbrotSet::TraceTile(Tile& tile)
+{
+    UWORD queue[TileSize * TileSize];
+    unsigned int head = 0;
+    unsigned int tail = 0;
+    auto enqueue = [&](UWORD p)
+    {
+        if(tile.classes[p] == Unknown)
+        {
+            tile.classes[p] = Queued;
+            queue[tail++] = p;
+        }
+    };
+    auto EnqueueAround = [&](int px, int py)
+    {
+        for(int y = max(py - 1, 0); y <= min(py + 1, tile.height - 1); ++y)
+        {
+            for(int x = max(px - 1, 0); x <= min(px + 1, tile.width - 1); ++x)
+            {
+                enqueue(y * tile.width + x);
+            }
+        }
+    };
+
+    // Every region inside the tile either touches its edge or is enclosed by a boundary,
+    // so starting from the edges reaches every boundary
+    for(UWORD x = 0; x < tile.width; ++x)
+    {
+        enqueue(x);
+        enqueue((tile.height - 1) * tile.width + x);
+    }
+    for(UWORD y = 1; y + 1 < tile.height; ++y)
+    {
+        enqueue(y * tile.width);
+        enqueue(y * tile.width + tile.width - 1);
+    }
+
+    while(head < tail)
+    {
+        // Everything queued so far goes to the kernel in one batch
+        unsigned int batchEnd = tail;
+        EvaluatePixels(tile, queue + head, batchEnd - head);
+
+        // Where a pixel and a known neighbour differ the boundary passes between them,
+        // so follow it by queueing the unknown pixels around both. Diagonals count as
+        // neighbours so one pixel wide filaments running at an angle are followed too.
+        for(; head < batchEnd; ++head)
+        {
+            UWORD p = queue[head];
+            int px = p % tile.width;
+            int py = p / tile.width;
+            bool boundary = false;
+            for(int y = max(py - 1, 0); y <= min(py + 1, tile.height - 1); ++y)
+            {
+                for(int x = max(px - 1, 0); x <= min(px + 1, tile.width - 1); ++x)
+                {
+                    UBYTE neighbour = tile.classes[y * tile.width + x];
+                    if(neighbour <= Escaped && neighbour != tile.classes[p])
+                    {
+                        boundary = true;
+                        EnqueueAround(x, y);
+                    }
+                }
+            }
+            if(boundary)
+                EnqueueAround(px, py);
+        }
+    }
+
+    // Pixels never reached are inside a region bounded by traced pixels of one class,
+    // and the left edge was traced, so each takes the class of its left neighbour
+    for(UWORD y = 0; y < tile.height; ++y)
+    {
+        UBYTE* row = tile.classes + y * tile.width;
+        for(UWORD x = 1; x < tile.width; ++x)
+        {
+            if(row[x] == Unknown)
+                row[x] = row[x - 1];
+        }
+    }
+}
+
+unsigned long long MandelbrotSet::CountMismatchedPixels(int iterations)
+{
+    UWORD widthByte = (renderedResX % 8 == 0) ? (renderedResX / 8) : (renderedResX / 8 + 1);
+    checkImage.resize((UDOUBLE)widthByte * renderedResY);
+
+    // Same tiles, same kernel, only the mode differs
+    UBYTE* image = rendered;
+    RenderMode renderMode = mode;
+    EscapeStats stats = frameStats;
+    double packTime = packMs;
+    rendered = checkImage.data();
+    swap(iterationBuffer, checkIterations);
+    checkIterations.resize(iterationBuffer.size());
+    mode = RenderMode::BruteForce;
+    unsigned int tilesX = (renderedResX + TileSize - 1) / TileSize;
+    unsigned int tilesY = (renderedResY + TileSize - 1) / TileSize;
+    pool->Run(tilesX * tilesY, [this, iterations](unsigned int, unsigned int tile) { RenderTile(tile, iterations, 1, 0); });
+    rendered = image;
+    swap(iterationBuffer, checkIterations);
+    mode = renderMode;
+    frameStats = stats;
+    packMs = packTime;
+
+    unsigned long long mismatched = 0;
+    for(size_t i = 0; i < checkImage.size(); ++i)
+    {
+        mismatched += __builtin_popcount(checkImage[i] ^ rendered[i]);
+    }
+    return mismatched;
+}
+
+int MandelbrotSet::GetEscapeIteration(double fX, double fY, int iterations, EscapeStats& stats)
+{
+    // Most of the initial view is inside these, no need to iterate them
+    if(IsInCardioidOrBulb(fX, fY))
+    {
+        stats.skippedInterior += max(iterations, 0);
+        return iterations;
+    }
+
     double z_x = fX;
     double z_y = fY;
 
+    // Brent cycle detection: once the orbit hits the value saved at the last power of two
+    // it is periodic and can never escape
+    double saved_x = z_x;
+    double saved_y = z_y;
+    int nextSave = FirstPeriodCheckpoint;
+
     for(int i = 0; i < iterations; ++i)
     {
         double z_x_old = z_x;
         z_x = z_x * z_x - z_y * z_y + fX;
         z_y = 2.0 * z_x_old * z_y + fY;
+        ++stats.iterations;
         auto sumSquared = pow(z_x, 2) + pow(z_y, 2);
         if (sumSquared > 4)
         {
-            return true;
+            return i;
+        }
+        if(z_x == saved_x && z_y == saved_y)
+        {
+            stats.skippedPeriodic += iterations - (i + 1);
+            return iterations;
+        }
+        if(i + 1 == nextSave)
+        {
+            saved_x = z_x;
+            saved_y = z_y;
+            nextSave *= 2;
         }
     }
-    return false;
+    return iterations;
+}
+
+void MandelbrotSet::BuildWhiteSums()
+{
+    // whiteSums[(y * (width + 1)) + x] is the number of white pixels above and left of (x, y)
+    UDOUBLE stride = renderedResX + 1;
+    whiteSums.resize(stride * (renderedResY + 1));
+    fill(whiteSums.begin(), whiteSums.begin() + stride, 0);
+
+    const uint16_t* counts = iterationBuffer.data();
+    for(UWORD row = 0; row < renderedResY; ++row)
+    {
+        const uint32_t* above = whiteSums.data() + row * stride;
+        uint32_t* sums = whiteSums.data() + (row + 1) * stride;
+        uint32_t runningRow = 0;
+        sums[0] = 0;
+        for(UWORD j = 0; j < renderedResX; ++j)
+        {
+            runningRow += counts[j] != InteriorIterations;
+            sums[j + 1] = above[j + 1] + runningRow;
+        }
+        counts += renderedResX;
+    }
+}
+
+unsigned int MandelbrotSet::CountWhite(int xStart, int yStart, int xEnd, int yEnd)
+{
+    UDOUBLE stride = renderedResX + 1;
+    return whiteSums[yEnd * stride + xEnd] - whiteSums[yStart * stride + xEnd]
+        - whiteSums[yEnd * stride + xStart] + whiteSums[yStart * stride + xStart];
 }
 
 unsigned long long MandelbrotSet::GetUniformnessOfArea(double fW, double fH, int xOffset, int yOffset, int wDiv, int hDiv)
@@ -103,76 +993,71 @@ bool MandelbrotSet::IsAreaUniform(int xOffset, int yOffset, double fW, double fH
 {
     int yInit = yOffset + static_cast<int>(fH / hDiv) * hStart;
     int xInit = xOffset + static_cast<int>(fW / wDiv) * wStart;
-    auto firstPoint = Paint_GetPixel(xInit , yInit);
+    int width = static_cast<int>(fW / wDiv);
+    int height = static_cast<int>(fH / hDiv);
 
-    for(unsigned int i = 0; i < static_cast<unsigned int>(fW / wDiv); ++i )
-    {
-        for(unsigned int j = 0; j < static_cast<unsigned int>(fH / hDiv); ++j )
-        {
-            int yTest = yOffset + static_cast<int>(fH / hDiv) * hStart + j;
-            int xTest = xOffset + static_cast<int>(fW / wDiv) * wStart + i;
-            auto testPoint = Paint_GetPixel(xTest , yTest);
-            if(testPoint != firstPoint)
-                return false;
-        }        
-    }
-
-    return true;
+    unsigned int white = CountWhite(xInit, yInit, xInit + width, yInit + height);
+    return white == 0 || white == (unsigned int)(width * height);
 }
 
 
 double MandelbrotSet::GetImprovedUniformnessOfArea(double fW, double fH, int xOffset, int yOffset, int wDiv, int hDiv)
 {
-    unsigned long long numWhite = 0;
-    unsigned long long numBlack = 0;
     double totalPixels = fW*fH;
+    unsigned int numWhite = CountWhite(xOffset, yOffset, xOffset + (int)fW, yOffset + (int)fH);
+    double numBlack = totalPixels - numWhite;
 
-    for(int wStart = 0; wStart < fW; ++wStart)
+    return max((double)numWhite / totalPixels, numBlack / totalPixels);
+}
+
+unsigned int MandelbrotSet::CountMixedWindows(int xOffset, int yOffset, int width, int height)
+{
+    // The quadrant's quadrants and their quadrants: where the next two zooms could go
+    unsigned int mixed = 0;
+    for(int divisions = 2; divisions <= 4; divisions *= 2)
     {
-        for(int hStart = 0; hStart < fH; ++hStart)
+        for(int i = 0; i < divisions; ++i)
         {
-            int xPointIndex = xOffset+wStart;
-            int yPointIndex = yOffset+hStart;
-            if(Paint_GetPixel(xPointIndex , yPointIndex) == WHITE)
-                numWhite++;
-            else
-                numBlack++;
+            for(int j = 0; j < divisions; ++j)
+            {
+                int xStart = xOffset + width * i / divisions;
+                int yStart = yOffset + height * j / divisions;
+                int xEnd = xOffset + width * (i + 1) / divisions;
+                int yEnd = yOffset + height * (j + 1) / divisions;
+                double uniformness = GetImprovedUniformnessOfArea(xEnd - xStart, yEnd - yStart, xStart, yStart, 1, 1);
+                if(uniformness < 0.85)
+                    ++mixed;
+            }
         }
     }
-
-    return max((double)numWhite / totalPixels, double(numBlack) / totalPixels);
+    return mixed;
 }
 
 
 void MandelbrotSet::ZoomOnInterestingArea()
 {   
-    tuple<double, double, double> choice;
-    vector<tuple<double, double, double>> choices;
-
-    auto uniformness = GetImprovedUniformnessOfArea(this->renderedResX / 2, this->renderedResY / 2, 0, 0, 2, 2);
-    choice = {this->x - this->w/4, this->y + this->h/4, uniformness};
-    choices.emplace_back(choice);
-
-    uniformness = GetImprovedUniformnessOfArea(this->renderedResX / 2, this->renderedResY / 2, this->renderedResX / 2, 0, 2, 2);
-    choice = {this->x + this->w/4, this->y + this->h/4, uniformness};
-    choices.emplace_back(choice);
-
-    uniformness = GetImprovedUniformnessOfArea(this->renderedResX / 2, this->renderedResY / 2, 0, this->renderedResY / 2, 2, 2);
-    choice = {this->x - this->w/4, this->y - this->h/4, uniformness};
-    choices.emplace_back(choice);
-
-    uniformness = GetImprovedUniformnessOfArea(this->renderedResX / 2, this->renderedResY / 2, this->renderedResX / 2, this->renderedResY / 2, 2, 2);
-    choice = {this->x + this->w/4, this->y - this->h/4, uniformness};
-    choices.emplace_back(choice);     
+    // Quadrants as the direction the centre moves in, how uniform they are,
+    // and how many of the windows inside them are still mixed
+    tuple<int, int, double, unsigned int> choice;
+    vector<tuple<int, int, double, unsigned int>> choices;
 
-    w = w / 2.0;
-    h = h / 2.0;
+    int halfW = this->renderedResX / 2;
+    int halfH = this->renderedResY / 2;
+    for(auto quadrant : {make_pair(-1, 1), make_pair(1, 1), make_pair(-1, -1), make_pair(1, -1)})
+    {
+        // Up is the top of the image
+        int xOffset = quadrant.first < 0 ? 0 : halfW;
+        int yOffset = quadrant.second > 0 ? 0 : halfH;
+        auto uniformness = GetImprovedUniformnessOfArea(halfW, halfH, xOffset, yOffset, 2, 2);
+        choice = {quadrant.first, quadrant.second, uniformness, CountMixedWindows(xOffset, yOffset, halfW, halfH)};
+        choices.emplace_back(choice);
+    }
 
     auto lessUniformChoices = choices;
     lessUniformChoices.erase(std::remove_if(
         lessUniformChoices.begin(),
         lessUniformChoices.end(),
-        [](const tuple<double, double, double>& x) { 
+        [](const tuple<int, int, double, unsigned int>& x) { 
             return (std::get<2>(x) >= 0.85); 
         }), lessUniformChoices.end());
 
@@ -180,34 +1065,60 @@ void MandelbrotSet::ZoomOnInterestingArea()
     topTierChoices.erase(std::remove_if(
         topTierChoices.begin(),
         topTierChoices.end(),
-        [](const tuple<double, double, double>& x) { 
+        [](const tuple<int, int, double, unsigned int>& x) { 
             return (std::get<2>(x) >= 0.75); 
         }), topTierChoices.end());
 
     // Seed
-    random_device rd;
-    mt19937 g(rd());
+    seed_seq seed{randomSeed, randomDraws++};
+    mt19937 g(seed);
+
+    auto& tier = topTierChoices.size() > 0 ? topTierChoices : (lessUniformChoices.size() > 0 ? lessUniformChoices : choices);
 
-    if(topTierChoices.size() > 0)
+    // Within a tier, quadrants with more mixed windows are likelier to stay interesting for the next zooms too
+    vector<double> weights;
+    for(auto& candidate : tier)
     {
-            shuffle(topTierChoices.begin(), topTierChoices.end(), g);
-            auto selection = topTierChoices[0];
-            this->x = get<0>(selection);
-            this->y = get<1>(selection);
+        weights.push_back(1 + get<3>(candidate));
     }
-    else if (lessUniformChoices.size() > 0)
+    discrete_distribution<size_t> pick(weights.begin(), weights.end());
+    auto selection = tier[pick(g)];
+    ZoomIntoQuadrant(get<0>(selection), get<1>(selection));
+
+    // The rest, best tier and most mixed first, in case a progressive render finds this one boring
+    auto rank = [](const tuple<int, int, double, unsigned int>& c)
     {
-            shuffle(lessUniformChoices.begin(), lessUniformChoices.end(), g);
-            auto selection = lessUniformChoices[0];
-            this->x = get<0>(selection);
-            this->y = get<1>(selection);
-    } 
-    else
+        return make_pair(get<2>(c) < 0.75 ? 0 : (get<2>(c) < 0.85 ? 1 : 2), -(int)get<3>(c));
+    };
+    sort(choices.begin(), choices.end(), [&rank](const tuple<int, int, double, unsigned int>& a,
+        const tuple<int, int, double, unsigned int>& b) { return rank(a) < rank(b); });
+    for(auto& candidate : choices)
     {
-            shuffle(choices.begin(), choices.end(), g);
-            auto selection = choices[0];
-            this->x = get<0>(selection);
-            this->y = get<1>(selection);
+        if(get<0>(candidate) != zoomDirection.first || get<1>(candidate) != zoomDirection.second)
+            zoomAlternatives.emplace_back(get<0>(candidate), get<1>(candidate));
     }
 }
 
+void MandelbrotSet::ZoomIntoQuadrant(int xDirection, int yDirection)
+{
+    w = w / 2.0;
+    h = h / 2.0;
+    MoveCentre(xDirection, yDirection);
+    zoomDirection = make_pair(xDirection, yDirection);
+    ++zoomLevel;
+    zoomPath = (zoomPath << 2) | QuadrantBits(zoomDirection);
+    zoomAlternatives.clear();
+}
+
+void MandelbrotSet::MoveCentre(int xDirection, int yDirection)
+{
+    // Keep 64 bits below the view width, enough for the centre and the reference orbit
+    unsigned int bits = max(0.0, ceil(-log2(w))) + 64;
+    unsigned int limbs = max(2u, (bits + 31) / 32);
+    x.SetFractionLimbs(limbs);
+    y.SetFractionLimbs(limbs);
+
+    // The new quadrant centre is half of the new width away, always an exact power of two
+    BigFixed::Add(x, BigFixed(xDirection * w / 2.0, limbs), x);
+    BigFixed::Add(y, BigFixed(yDirection * h / 2.0, limbs), y);
+}
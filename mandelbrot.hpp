@@ -1,29 +1,248 @@
+#ifndef MANDELBROT_HPP
+#define MANDELBROT_HPP
 
 #include "DEV_Config.h"
+#include "workpool.hpp"
+#include "escapetime.hpp"
+#include "bigfixed.hpp"
+#include "perturbation.hpp"
+#include "doubledouble.hpp"
+#include "tilecache.hpp"
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
 
 class MandelbrotSet
 {
 public:
+    // Scalar is GetEscapeIteration one pixel at a time and stays as the reference;
+    // Simd gives the same image through the vectorised EscapeTimeBatch
+    enum class Kernel { Scalar, Simd };
+    // Arithmetic a frame is rendered with, picked from the pixel spacing
+    enum class Precision { Double, DoubleDouble, Perturbation };
+    // BruteForce iterates every pixel. Subdivide (Mariani-Silver) only iterates the border of a
+    // rectangle and fills it when the border is all one class, since the set is connected.
+    // Trace follows the boundary between escaped and bounded pixels from the tile edges
+    // and fills whatever it encloses.
+    enum class RenderMode { BruteForce, Subdivide, Trace };
+
+    // Everything that decides which views come next, so a zoom path can be saved and carried on later
+    struct ViewState
+    {
+        BigFixed x;
+        BigFixed y;
+        double w;
+        double h;
+        unsigned int zoomLevel;
+        uint64_t zoomPath;
+        std::pair<int, int> zoomDirection;
+        std::vector<std::pair<int, int>> zoomAlternatives;
+        double budgetScale;
+        uint32_t randomSeed;
+        uint32_t randomDraws;
+    };
+
+    MandelbrotSet();
     void InitMandelbrotSet();
+    ViewState GetViewState();
+    void SetViewState(const ViewState& state);
     void Render(UWORD xResolution, UWORD yResolution);
     void SetRender(UBYTE* image);
     UBYTE* GetRender() { return rendered; };
     void ZoomOnInterestingArea();
+    // Zooms 2x into the quadrant in the given directions, -1 or 1 each, with up the top of the image
+    void ZoomIntoQuadrant(int xDirection, int yDirection);
+    // Makes the quadrants ZoomOnInterestingArea picks repeat from run to run
+    void SetRandomSeed(uint32_t seed) { randomSeed = seed; randomDraws = 0; };
+
+    // 0 picks one thread per core, 1 renders on the calling thread only
+    void SetThreadCount(unsigned int threads);
+    unsigned int GetThreadCount();
+    double GetLastRenderMs() { return lastRenderMs; };
+    void SetKernel(Kernel kernel) { this->kernel = kernel; };
+    void SetRenderMode(RenderMode mode) { this->mode = mode; };
+    // Renders every frame a second time by brute force and logs how many pixels the mode got wrong
+    void SetSelfCheck(bool enabled) { selfCheck = enabled; };
+    // Adapts the iteration budget to how many pixels escape close to it instead of only using the depth
+    void SetAdaptiveIterations(bool enabled) { adaptiveIterations = enabled; };
+    // Renders a brute force frame at 1/8 and 1/4 resolution first and, when that is almost all one colour,
+    // zooms into the next best quadrant instead. The preview pixels are part of the final frame.
+    void SetProgressive(bool enabled) { progressive = enabled; };
+    // Views near the root are looked up in the cache before rendering and stored in it after. NULL for none.
+    void SetTileCache(TileCache* cache) { tileCache = cache; };
+    const EscapeStats& GetFrameStats() { return frameStats; };
+
+    // Per pixel result of the last frame, row by row with GetRenderedWidth() entries each: the iteration
+    // on which the pixel escaped, or one of the markers below. The 1bpp image is thresholded from this.
+    static constexpr uint16_t InteriorIterations = 0xFFFF;  // never escaped within the budget
+    static constexpr uint16_t FilledIterations = 0xFFFE;    // escaped, inferred from neighbours without iterating
+    static constexpr uint16_t MaxStoredIterations = 0xFFFD; // iteration budgets are capped to this
+    const uint16_t* GetIterationBuffer() { return iterationBuffer.data(); };
+    UWORD GetRenderedWidth() { return renderedResX; };
+    UWORD GetRenderedHeight() { return renderedResY; };
+    Precision GetFramePrecision() { return precision; };
+    unsigned int GetZoomLevel() { return zoomLevel; };
 
 private:
-    bool IsMandelPoint(double x, double y, int iterations);
+    static constexpr UWORD TileSize = 32;
+    // Rectangles this narrow are iterated outright rather than split again
+    static constexpr UWORD SubdivideMinSize = 6;
+    // Fraction of pixels escaping in the top quarter of the budget the adaptive budget aims for,
+    // and the fraction above which unresolved pixels are iterated further straight away
+    // On zooms into the boundary that fraction hardly drops as the budget grows, so the targets are
+    // loose and the budget stays within a few times the heuristic either way.
+    static constexpr double NearCapTarget = 0.005;
+    static constexpr double DeepenNearCap = 0.02;
+    static constexpr int MaxDeepenRounds = 2;
+    static constexpr double MinBudgetScale = 0.25;
+    static constexpr double MaxBudgetScale = 4;
+    // Below this pixel spacing (relative to the centre) plain doubles can't tell neighbouring
+    // pixels apart well enough and the frame is iterated in double-double instead
+    static constexpr double DoubleDoubleSpacing = 1e-12;
+    // Below this even double-double runs out of bits and the frame is rendered by perturbation
+    static constexpr double PerturbationSpacing = 1e-28;
+    // Share of the preview in its majority colour above which a view is abandoned
+    static constexpr double PreviewUniformLimit = 0.98;
+
+    // Iteration on which the point escaped, or iterations if it didn't
+    int GetEscapeIteration(double x, double y, int iterations, EscapeStats& stats);
+    void MapCoordinates();
+    void PrepareFrame(int iterations, bool parentRecorded);
+    TileCache::Key GetCacheKey(int iterations);
+    bool LoadCachedView(int iterations);
+    void RenderTile(unsigned int tile, int iterations, UWORD stride, UWORD previousStride);
+    // Fraction of the pixels on a grid of the given spacing in the majority colour
+    double GetPreviewUniformness(UWORD stride);
+    // Tile being rendered, with the escape class of each of its pixels row by row
+    enum : UBYTE { Bounded = 0, Escaped = 1, Unknown = 2, Queued = 3 };
+    struct Tile
+    {
+        UWORD xStart;
+        UWORD yStart;
+        UWORD width;
+        UWORD height;
+        int iterations;
+        // Pass the tile is rendered in: only pixels on the stride grid and not on the one before
+        UWORD stride;
+        UWORD previousStride;
+        UBYTE classes[TileSize * TileSize];
+        bool evaluated[TileSize * TileSize];
+        EscapeStats stats;
+    };
+    // Runs the frame's kernel on the given pixels (indices into tile.classes) and records their classes
+    void EvaluatePixels(Tile& tile, const UWORD* pixels, unsigned int count);
+    void SubdivideRect(Tile& tile, UWORD x0, UWORD y0, UWORD x1, UWORD y1);
+    void TraceTile(Tile& tile);
+    // Derives the 1bpp bytes of a tile from the iteration buffer
+    void ThresholdTile(const Tile& tile);
+    void AdaptIterationBudget(int iterations, int fixedIterations, std::chrono::steady_clock::time_point start);
+    unsigned int CountEscapesFrom(int iteration);
+    // Carries the unresolved pixels of a recorded frame on to a bigger budget from their stored orbits
+    void DeepenTile(unsigned int tile, int iterations);
+    // Brute force with the double SIMD kernel, storing every pixel's result and reusing the parent frame's
+    void EvaluateTileRecorded(Tile& tile);
+    bool MatchParentPixels();
+    static bool InPass(const Tile& tile, UWORD j, UWORD row)
+    {
+        return j % tile.stride == 0 && row % tile.stride == 0
+            && !(tile.previousStride && j % tile.previousStride == 0 && row % tile.previousStride == 0);
+    }
+    static uint16_t StoredIterations(int escapedAt, int iterations)
+    {
+        return escapedAt < iterations ? (uint16_t)escapedAt : InteriorIterations;
+    }
+    unsigned long long CountMismatchedPixels(int iterations);
+    template<typename T>
+    static void GatherPixels(const T* columns, const T* rows, const Tile& tile, const UWORD* pixels, unsigned int count,
+        T* cx, T* cy)
+    {
+        for(unsigned int p = 0; p < count; ++p)
+        {
+            cx[p] = columns[tile.xStart + pixels[p] % tile.width];
+            cy[p] = rows[tile.yStart + pixels[p] / tile.width];
+        }
+    }
+    void MoveCentre(int xDirection, int yDirection);
+    // Quadrant the last zoom went into and the others, best first, for a progressive frame to fall back on
+    std::pair<int, int> zoomDirection;
+    std::vector<std::pair<int, int>> zoomAlternatives;
+    // Zooms since the root view and the quadrant of each, two bits per zoom with the latest lowest
+    unsigned int zoomLevel;
+    uint64_t zoomPath;
+    static uint64_t QuadrantBits(std::pair<int, int> direction)
+    {
+        return (direction.first > 0 ? 1 : 0) | (direction.second < 0 ? 2 : 0);
+    }
+    TileCache* tileCache;
+    // Each zoom seeds its generator from these two, so the choices can be replayed after a restart
+    uint32_t randomSeed;
+    uint32_t randomDraws;
     unsigned long long GetUniformnessOfArea(double fW, double fH, int xOffset, int yOffset, int wDiv, int hDiv);
     bool IsAreaUniform(int xOffset, int yOffset, double fW, double fH,  int wDiv, int hDiv, double wStart, double hStart);
 
 
     double GetImprovedUniformnessOfArea(double fW, double fH, int xOffset, int yOffset, int wDiv, int hDiv);
+    unsigned int CountMixedWindows(int xOffset, int yOffset, int width, int height);
+    // Summed-area table of the white pixels of the last frame, so any window's count is four lookups
+    void BuildWhiteSums();
+    unsigned int CountWhite(int xStart, int yStart, int xEnd, int yEnd);
 
     UBYTE* rendered;
     double w;
     double h;
-    double x;
-    double y;
+    // View centre, with as many bits as the zoom depth needs
+    BigFixed x;
+    BigFixed y;
+    // Centre rounded to doubles and double-doubles for the frame being rendered
+    double renderX;
+    double renderY;
+    DoubleDouble renderXX;
+    DoubleDouble renderYY;
+    Precision precision;
+    ReferenceOrbit reference;
+    // Pixel coordinates of the frame, per column and per row
+    std::vector<double> columnX;
+    std::vector<double> rowY;
+    std::vector<DoubleDouble> columnXX;
+    std::vector<DoubleDouble> rowYY;
+
+    // Kept across frames so it is only allocated when the resolution grows
+    std::vector<uint16_t> iterationBuffer;
+    std::vector<uint16_t> checkIterations;
+    std::vector<uint32_t> whiteSums;
+    // Final orbit of every pixel of this frame and of the one before it, kept when the frame is
+    // rendered by brute force in doubles so the next zoom can build on it with the iteration buffers
+    bool recordFrame;
+    bool reuseParent;
+    std::vector<OrbitState> pixelOrbits;
+    std::vector<uint16_t> parentIterationBuffer;
+    std::vector<OrbitState> parentOrbits;
+    std::vector<double> parentColumnX;
+    std::vector<double> parentRowY;
+    UWORD parentResX;
+    UWORD parentResY;
+    // Parent column and row at exactly the same coordinate as each of this frame's, or -1
+    std::vector<int> parentColumn;
+    std::vector<int> parentRow;
     UWORD renderedResX;
     UWORD renderedResY;
+
+    std::unique_ptr<WorkStealingPool> pool;
+    unsigned int threadCount;
+    Kernel kernel;
+    RenderMode mode;
+    bool selfCheck;
+    bool adaptiveIterations;
+    bool progressive;
+    double budgetScale;
+    std::vector<UBYTE> checkImage;
+    EscapeStats frameStats;
+    std::mutex statsLock;
+    double lastRenderMs;
+    double packMs;
 };
 
+#endif
@@ -0,0 +1,105 @@
+#include "metrics.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <mutex>
+#include <string>
+
+using namespace std;
+
+static const char* PhaseNames[] = {"render", "zoom_scoring", "panel_init", "panel_clear", "panel_display", "panel_busy_wait", "panel_sleep"};
+static_assert(sizeof(PhaseNames) / sizeof(PhaseNames[0]) == (size_t)Metrics::Phase::Count, "a name for every phase");
+
+static mutex metricsLock;
+static string outputPath;
+static double phaseSeconds[(size_t)Metrics::Phase::Count];
+static double lastPhaseSeconds[(size_t)Metrics::Phase::Count];
+static unsigned long long phaseRuns[(size_t)Metrics::Phase::Count];
+static unsigned long long frames;
+static unsigned long long pixelsRendered;
+static EscapeStats totals;
+static unsigned int lastZoomLevel;
+
+void Metrics::SetOutput(const char* path)
+{
+    lock_guard<mutex> guard(metricsLock);
+    outputPath = path != NULL ? path : "";
+}
+
+void Metrics::AddPhase(Phase phase, double seconds)
+{
+    lock_guard<mutex> guard(metricsLock);
+    phaseSeconds[(size_t)phase] += seconds;
+    lastPhaseSeconds[(size_t)phase] = seconds;
+    ++phaseRuns[(size_t)phase];
+}
+
+void Metrics::AddFrame(const EscapeStats& stats, unsigned long long pixels, unsigned int zoomLevel)
+{
+    lock_guard<mutex> guard(metricsLock);
+    ++frames;
+    pixelsRendered += pixels;
+    totals.Add(stats);
+    lastZoomLevel = zoomLevel;
+}
+
+void Metrics::Flush()
+{
+    lock_guard<mutex> guard(metricsLock);
+    if(outputPath.empty())
+        return;
+
+    string temporary = outputPath + ".tmp";
+    FILE* file = fopen(temporary.c_str(), "w");
+    if(file == NULL)
+    {
+        perror("Metrics open");
+        return;
+    }
+
+    fprintf(file, "# HELP piartframe_phase_seconds_total Time spent in each phase of the frame loop.\n");
+    fprintf(file, "# TYPE piartframe_phase_seconds_total counter\n");
+    for(size_t p = 0; p < (size_t)Phase::Count; ++p)
+        fprintf(file, "piartframe_phase_seconds_total{phase=\"%s\"} %.6f\n", PhaseNames[p], phaseSeconds[p]);
+    fprintf(file, "# HELP piartframe_phase_runs_total Number of times each phase ran.\n");
+    fprintf(file, "# TYPE piartframe_phase_runs_total counter\n");
+    for(size_t p = 0; p < (size_t)Phase::Count; ++p)
+        fprintf(file, "piartframe_phase_runs_total{phase=\"%s\"} %llu\n", PhaseNames[p], phaseRuns[p]);
+    fprintf(file, "# HELP piartframe_phase_last_seconds Duration of the latest run of each phase.\n");
+    fprintf(file, "# TYPE piartframe_phase_last_seconds gauge\n");
+    for(size_t p = 0; p < (size_t)Phase::Count; ++p)
+        fprintf(file, "piartframe_phase_last_seconds{phase=\"%s\"} %.6f\n", PhaseNames[p], lastPhaseSeconds[p]);
+
+    fprintf(file, "# HELP piartframe_frames_total Frames rendered.\n");
+    fprintf(file, "# TYPE piartframe_frames_total counter\n");
+    fprintf(file, "piartframe_frames_total %llu\n", frames);
+    fprintf(file, "# HELP piartframe_iterations_total Escape time iterations run.\n");
+    fprintf(file, "# TYPE piartframe_iterations_total counter\n");
+    fprintf(file, "piartframe_iterations_total %llu\n", totals.iterations);
+    fprintf(file, "# HELP piartframe_iterations_skipped_total Iterations saved, by how.\n");
+    fprintf(file, "# TYPE piartframe_iterations_skipped_total counter\n");
+    fprintf(file, "piartframe_iterations_skipped_total{reason=\"cardioid_bulb\"} %llu\n", totals.skippedInterior);
+    fprintf(file, "piartframe_iterations_skipped_total{reason=\"periodic\"} %llu\n", totals.skippedPeriodic);
+    fprintf(file, "piartframe_iterations_skipped_total{reason=\"previous_frame\"} %llu\n", totals.reusedIterations);
+    fprintf(file, "# HELP piartframe_pixels_total Pixels of all frames rendered.\n");
+    fprintf(file, "# TYPE piartframe_pixels_total counter\n");
+    fprintf(file, "piartframe_pixels_total %llu\n", pixelsRendered);
+    fprintf(file, "# HELP piartframe_pixels_iterated_total Pixels run through an escape time kernel.\n");
+    fprintf(file, "# TYPE piartframe_pixels_iterated_total counter\n");
+    fprintf(file, "piartframe_pixels_iterated_total %llu\n", totals.pixels);
+    fprintf(file, "# HELP piartframe_pixels_skipped_total Pixels filled, reused or loaded without iterating them.\n");
+    fprintf(file, "# TYPE piartframe_pixels_skipped_total counter\n");
+    fprintf(file, "piartframe_pixels_skipped_total %llu\n", pixelsRendered - min(pixelsRendered, totals.pixels));
+    fprintf(file, "# HELP piartframe_rebases_total Perturbation rebases onto the reference orbit.\n");
+    fprintf(file, "# TYPE piartframe_rebases_total counter\n");
+    fprintf(file, "piartframe_rebases_total %llu\n", totals.rebases);
+    fprintf(file, "# HELP piartframe_zoom_level Zooms since the whole set, of the latest frame.\n");
+    fprintf(file, "# TYPE piartframe_zoom_level gauge\n");
+    fprintf(file, "piartframe_zoom_level %u\n", lastZoomLevel);
+
+    bool written = fflush(file) == 0 && !ferror(file);
+    if(fclose(file) != 0 || !written || rename(temporary.c_str(), outputPath.c_str()) != 0)
+    {
+        perror("Metrics write");
+        remove(temporary.c_str());
+    }
+}
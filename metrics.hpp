@@ -0,0 +1,22 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include "escapetime.hpp"
+
+// Time spent in each phase of the frame loop and what the renders did, kept for the whole run.
+// Everything is booked once per phase or frame, never per pixel. Flush writes it all out in the
+// Prometheus text format for the node exporter's textfile collector to pick up.
+class Metrics
+{
+public:
+    enum class Phase { Render, ZoomScoring, PanelInit, PanelClear, PanelDisplay, PanelBusyWait, PanelSleep, Count };
+
+    // File Flush writes to, NULL (the default) to keep the numbers in memory only
+    static void SetOutput(const char* path);
+    static void AddPhase(Phase phase, double seconds);
+    static void AddFrame(const EscapeStats& stats, unsigned long long pixels, unsigned int zoomLevel);
+    // Replaces the file in one rename, so a scrape never sees half of it
+    static void Flush();
+};
+
+#endif
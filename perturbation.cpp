@@ -0,0 +1,104 @@
+#include "perturbation.hpp"
+
+using namespace std;
+
+void ReferenceOrbit::Compute(const BigFixed& cx, const BigFixed& cy, unsigned int maxLength)
+{
+    zx.clear();
+    zy.clear();
+    zx.reserve(maxLength);
+    zy.reserve(maxLength);
+
+    unsigned int limbs = cx.GetFractionLimbs();
+    for(BigFixed* value : {&x, &y, &xx, &yy, &xy})
+    {
+        value->SetFractionLimbs(limbs);
+        value->SetDouble(0.0);
+    }
+
+    zx.push_back(0);
+    zy.push_back(0);
+    while(zx.size() < max(maxLength, 2u))
+    {
+        BigFixed::Mul(x, x, xx);
+        BigFixed::Mul(y, y, yy);
+        BigFixed::Mul(x, y, xy);
+        BigFixed::Sub(xx, yy, x);
+        BigFixed::Add(x, cx, x);
+        BigFixed::Add(xy, xy, y);
+        BigFixed::Add(y, cy, y);
+
+        // Z_1 is always kept, even when C is already outside |C| = 2, so PerturbationBatch always
+        // has a step to take from Z_0 after rebasing
+        double nextX = x.ToDouble();
+        double nextY = y.ToDouble();
+        if(nextX * nextX + nextY * nextY > 4 && zx.size() > 1)
+            break;
+
+        zx.push_back(nextX);
+        zy.push_back(nextY);
+    }
+}
+
+void PerturbationBatch(const ReferenceOrbit& orbit, double refX, double refY, const double* dcx, const double* dcy,
+    unsigned int count, int iterations, int* escapedAt, EscapeStats& stats)
+{
+    const double* zx = orbit.GetX();
+    const double* zy = orbit.GetY();
+    unsigned int last = orbit.GetLength() - 1;
+
+    for(unsigned int p = 0; p < count; ++p)
+    {
+        escapedAt[p] = iterations;
+
+        // Deep inside a cardioid or bulb, double precision is plenty to tell
+        if(IsInCardioidOrBulb(refX + dcx[p], refY + dcy[p]))
+        {
+            stats.skippedInterior += max(iterations, 0);
+            continue;
+        }
+
+        // Start from Z_1 = C, the same place GetEscapeIteration starts
+        double dx = dcx[p];
+        double dy = dcy[p];
+        unsigned int m = 1;
+
+        for(int i = 0; i < iterations; ++i)
+        {
+            // The orbit has no Z_m+1 to step to, so fold Z_m in and carry on from Z_0 = 0. The
+            // orbit can be as short as Z_0 and Z_1 when the reference escapes straight away.
+            if(m == last)
+            {
+                dx += zx[m];
+                dy += zy[m];
+                m = 0;
+                ++stats.rebases;
+            }
+
+            // d' = 2 Z d + d^2 + dc
+            double nextX = 2.0 * (zx[m] * dx - zy[m] * dy) + (dx * dx - dy * dy) + dcx[p];
+            double nextY = 2.0 * (zx[m] * dy + zy[m] * dx) + 2.0 * dx * dy + dcy[p];
+            dx = nextX;
+            dy = nextY;
+            ++m;
+            ++stats.iterations;
+
+            double fullX = zx[m] + dx;
+            double fullY = zy[m] + dy;
+            double sumSquared = fullX * fullX + fullY * fullY;
+            if(sumSquared > 4)
+            {
+                escapedAt[p] = i;
+                break;
+            }
+
+            if(sumSquared < dx * dx + dy * dy)
+            {
+                dx = fullX;
+                dy = fullY;
+                m = 0;
+                ++stats.rebases;
+            }
+        }
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef PERTURBATION_HPP
+#define PERTURBATION_HPP
+
+#include "bigfixed.hpp"
+#include "escapetime.hpp"
+#include <vector>
+
+// Orbit of one reference point C for perturbation rendering, Z_0 = 0, Z_1 = C, Z_n+1 = Z_n^2 + C.
+// Iterated with BigFixed at whatever precision the zoom needs and stored rounded to doubles,
+// stopping once the orbit escapes.
+class ReferenceOrbit
+{
+public:
+    void Compute(const BigFixed& cx, const BigFixed& cy, unsigned int maxLength);
+
+    unsigned int GetLength() const { return zx.size(); };
+    const double* GetX() const { return zx.data(); };
+    const double* GetY() const { return zy.data(); };
+
+private:
+    std::vector<double> zx;
+    std::vector<double> zy;
+    // Working values, kept between frames so a new orbit only allocates when the precision grows
+    BigFixed x, y, xx, yy, xy;
+};
+
+// Iterates points given as double offsets (dcx, dcy) from the reference point, tracking only
+// each pixel's difference from the reference orbit so the cost per pixel stays that of doubles.
+// When a pixel's value gets smaller than its difference (where precision would be lost and the
+// image glitch) or it outlives the reference, the difference is rebased onto the start of the
+// orbit. Same escapedAt convention as EscapeTimeBatch.
+void PerturbationBatch(const ReferenceOrbit& orbit, double refX, double refY, const double* dcx, const double* dcy,
+    unsigned int count, int iterations, int* escapedAt, EscapeStats& stats);
+
+#endif
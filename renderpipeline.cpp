@@ -0,0 +1,143 @@
+#include "renderpipeline.hpp"
+#include "metrics.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace chrono;
+
+RenderPipeline::RenderPipeline(MandelbrotSet& mandelbrot, UWORD width, UWORD height, unsigned int zoomsBeforeRestart,
+    const char* checkpointPath, const Checkpoint* resume)
+    : mandelbrot(mandelbrot)
+{
+    this->width = width;
+    this->height = height;
+    this->zoomsBeforeRestart = zoomsBeforeRestart;
+    this->checkpointPath = checkpointPath;
+    numberOfZooms = 1;
+    if(resume != NULL)
+    {
+        mandelbrot.SetViewState(resume->view);
+        numberOfZooms = resume->numberOfZooms;
+    }
+
+    UDOUBLE imageSize = (UDOUBLE)((width % 8 == 0) ? (width / 8) : (width / 8 + 1)) * height;
+    buffers[0] = (UBYTE*)malloc(imageSize);
+    buffers[1] = (UBYTE*)malloc(imageSize);
+    if(buffers[0] == NULL || buffers[1] == NULL)
+    {
+        printf("Failed to apply for image memory...\r\n");
+        exit(-1);
+    }
+
+    readyBuffer = -1;
+    freeBuffer = 0;
+    firstFrame = true;
+    stopping = false;
+    worker = thread(&RenderPipeline::WorkerLoop, this);
+}
+
+RenderPipeline::~RenderPipeline()
+{
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    changed.notify_all();
+    worker.join();
+    free(buffers[0]);
+    free(buffers[1]);
+}
+
+UBYTE* RenderPipeline::TakeFrame(steady_clock::time_point deadline)
+{
+    unique_lock<mutex> guard(lock);
+    if(!changed.wait_until(guard, deadline, [this] { return readyBuffer >= 0; }))
+        return NULL;
+    return TakeReadyFrame(guard);
+}
+
+UBYTE* RenderPipeline::TakeFrame()
+{
+    unique_lock<mutex> guard(lock);
+    changed.wait(guard, [this] { return readyBuffer >= 0; });
+    return TakeReadyFrame(guard);
+}
+
+UBYTE* RenderPipeline::TakeReadyFrame(unique_lock<mutex>& guard)
+{
+    // The frame shown until now is done with, the next one can go into its buffer
+    int taken = readyBuffer;
+    readyBuffer = -1;
+    freeBuffer = 1 - taken;
+    guard.unlock();
+    changed.notify_all();
+    return buffers[taken];
+}
+
+void RenderPipeline::WorkerLoop()
+{
+    // Threads inherit the niceness of the thread that creates them, so this also covers
+    // the render pool, which is created by the first render below
+    if(setpriority(PRIO_PROCESS, syscall(SYS_gettid), WorkerNiceness) != 0)
+    {
+        printf("Could not lower the render priority, rendering at normal priority\r\n");
+    }
+
+    while(true)
+    {
+        int target;
+        {
+            unique_lock<mutex> guard(lock);
+            changed.wait(guard, [this] { return stopping || freeBuffer >= 0; });
+            if(stopping)
+                return;
+            target = freeBuffer;
+        }
+
+        // The zoom is scored on the frame rendered last, which is still held by the render
+        if(!firstFrame)
+        {
+            steady_clock::time_point zoomStart = steady_clock::now();
+            mandelbrot.ZoomOnInterestingArea();
+            Metrics::AddPhase(Metrics::Phase::ZoomScoring, duration<double>(steady_clock::now() - zoomStart).count());
+            if(numberOfZooms % zoomsBeforeRestart == 0)
+            {
+                mandelbrot.InitMandelbrotSet();
+            }
+            numberOfZooms++;
+
+            // The frame before this one has just been taken for display. Saved before the render,
+            // a restart renders this view again instead of zooming past it.
+            if(checkpointPath != NULL)
+            {
+                Checkpoint checkpoint{mandelbrot.GetViewState(), numberOfZooms, (int64_t)time(NULL)};
+                if(!SaveCheckpoint(checkpointPath, checkpoint))
+                {
+                    printf("Could not save the checkpoint, a restart will begin from the whole set\r\n");
+                }
+            }
+        }
+        firstFrame = false;
+
+        printf("Starting render...\r\n");
+        mandelbrot.SetRender(buffers[target]);
+        steady_clock::time_point renderStart = steady_clock::now();
+        mandelbrot.Render(width, height);
+        Metrics::AddPhase(Metrics::Phase::Render, duration<double>(steady_clock::now() - renderStart).count());
+        Metrics::AddFrame(mandelbrot.GetFrameStats(), (unsigned long long)width * height, mandelbrot.GetZoomLevel());
+        Metrics::Flush();
+        printf("Render complete!\r\n");
+
+        {
+            lock_guard<mutex> guard(lock);
+            freeBuffer = -1;
+            readyBuffer = target;
+        }
+        changed.notify_all();
+    }
+}
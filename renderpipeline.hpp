@@ -0,0 +1,52 @@
+#ifndef RENDERPIPELINE_HPP
+#define RENDERPIPELINE_HPP
+
+#include "mandelbrot.hpp"
+#include "checkpoint.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Renders the next frame on a low priority background thread while the current one is on display.
+// Two image buffers take turns: once a frame is taken for display, the buffer of the frame before it
+// is free again and the worker zooms and renders into it straight away.
+class RenderPipeline
+{
+public:
+    // With a checkpoint path, the state is saved there every time a frame is taken for display.
+    // Given a checkpoint to resume from, the first frame rendered is the view it was zooming into.
+    RenderPipeline(MandelbrotSet& mandelbrot, UWORD width, UWORD height, unsigned int zoomsBeforeRestart,
+        const char* checkpointPath = NULL, const Checkpoint* resume = NULL);
+    ~RenderPipeline();
+
+    // Waits for the next frame until the deadline. Returns NULL if it isn't ready by then,
+    // otherwise the image, which stays valid until the following frame is taken.
+    UBYTE* TakeFrame(std::chrono::steady_clock::time_point deadline);
+    UBYTE* TakeFrame();
+
+    static constexpr int WorkerNiceness = 10;
+
+private:
+    void WorkerLoop();
+    UBYTE* TakeReadyFrame(std::unique_lock<std::mutex>& guard);
+
+    MandelbrotSet& mandelbrot;
+    UWORD width;
+    UWORD height;
+    unsigned int zoomsBeforeRestart;
+    unsigned int numberOfZooms;
+    const char* checkpointPath;
+
+    UBYTE* buffers[2];
+    // Indices into buffers, -1 for none
+    int readyBuffer;
+    int freeBuffer;
+    bool firstFrame;
+    bool stopping;
+    std::mutex lock;
+    std::condition_variable changed;
+    std::thread worker;
+};
+
+#endif
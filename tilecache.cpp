@@ -0,0 +1,193 @@
+#include "tilecache.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+static const char TileCacheMagic[8] = {'P', 'A', 'F', 'T', 'I', 'L', 'E', '1'};
+
+TileCache::TileCache(const char* path, size_t maxBytes, UWORD width, UWORD height, bool storeIterations)
+{
+    fd = -1;
+    mappedSize = 0;
+    header = NULL;
+    slots = NULL;
+    hits = 0;
+    misses = 0;
+    evictions = 0;
+
+    imageBytes = (size_t)((width % 8 == 0) ? (width / 8) : (width / 8 + 1)) * height;
+    iterationBytes = storeIterations ? (size_t)width * height * sizeof(uint16_t) : 0;
+    slotBytes = imageBytes + iterationBytes;
+    slotCount = maxBytes > sizeof(FileHeader) ? (maxBytes - sizeof(FileHeader)) / (sizeof(Slot) + slotBytes) : 0;
+    if(slotCount == 0)
+    {
+        printf("Tile cache of %zu bytes is too small for a single view\r\n", maxBytes);
+        return;
+    }
+    size_t size = sizeof(FileHeader) + slotCount * (sizeof(Slot) + slotBytes);
+
+    fd = open(path, O_RDWR | O_CREAT, 0644);
+    if(fd < 0)
+    {
+        perror("Tile cache open");
+        return;
+    }
+    struct stat info;
+    bool fresh = fstat(fd, &info) != 0 || (size_t)info.st_size != size;
+    if(fresh && ftruncate(fd, size) != 0)
+    {
+        perror("Tile cache resize");
+        close(fd);
+        fd = -1;
+        return;
+    }
+
+    void* mapped = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(mapped == MAP_FAILED)
+    {
+        perror("Tile cache mmap");
+        close(fd);
+        fd = -1;
+        return;
+    }
+    mappedSize = size;
+    header = (FileHeader*)mapped;
+    slots = (Slot*)(header + 1);
+
+    // A file left by a different image size or layout starts over
+    if(fresh || memcmp(header->magic, TileCacheMagic, sizeof(TileCacheMagic)) != 0 || header->width != width
+        || header->height != height || header->slotCount != slotCount || header->storeIterations != storeIterations)
+    {
+        memset(mapped, 0, size);
+        memcpy(header->magic, TileCacheMagic, sizeof(TileCacheMagic));
+        header->width = width;
+        header->height = height;
+        header->slotCount = slotCount;
+        header->storeIterations = storeIterations;
+    }
+
+    unsigned int used = 0;
+    for(unsigned int s = 0; s < slotCount; ++s)
+    {
+        used += slots[s].valid != 0;
+    }
+    printf("Tile cache %s: %u of %u views in use\r\n", path, used, slotCount);
+}
+
+TileCache::~TileCache()
+{
+    if(header != NULL)
+    {
+        munmap(header, mappedSize);
+    }
+    if(fd >= 0)
+    {
+        close(fd);
+    }
+}
+
+int TileCache::FindSlot(const Key& key)
+{
+    for(unsigned int s = 0; s < slotCount; ++s)
+    {
+        if(slots[s].valid && slots[s].level == key.level && slots[s].path == key.path && slots[s].params == key.params)
+            return s;
+    }
+    return -1;
+}
+
+UBYTE* TileCache::SlotData(unsigned int slot)
+{
+    return (UBYTE*)(slots + slotCount) + slot * slotBytes;
+}
+
+// Writes the pages holding [start, start + length) back to the file and waits for them to get there
+bool TileCache::Sync(const void* start, size_t length)
+{
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t offset = (const UBYTE*)start - (const UBYTE*)header;
+    size_t first = offset / page * page;
+    if(msync((UBYTE*)header + first, offset + length - first, MS_SYNC) != 0)
+    {
+        perror("Tile cache msync");
+        return false;
+    }
+    return true;
+}
+
+bool TileCache::Lookup(const Key& key, UBYTE* image, uint16_t* iterations, double& budgetScale, bool& hasIterations)
+{
+    if(header == NULL || key.level > MaxLevel)
+        return false;
+
+    int slot = FindSlot(key);
+    if(slot < 0)
+    {
+        ++misses;
+        return false;
+    }
+
+    ++hits;
+    const UBYTE* data = SlotData(slot);
+    memcpy(image, data, imageBytes);
+    hasIterations = slots[slot].hasIterations != 0;
+    if(hasIterations && iterations != NULL)
+    {
+        memcpy(iterations, data + imageBytes, iterationBytes);
+    }
+    budgetScale = slots[slot].budgetScale;
+    slots[slot].lastUse = ++header->clock;
+    return true;
+}
+
+void TileCache::Store(const Key& key, const UBYTE* image, const uint16_t* iterations, double budgetScale)
+{
+    if(header == NULL || key.level > MaxLevel)
+        return;
+
+    // The same view again replaces itself, otherwise an empty slot or the least recently used one
+    int slot = FindSlot(key);
+    for(unsigned int s = 0; slot < 0 && s < slotCount; ++s)
+    {
+        if(!slots[s].valid)
+            slot = s;
+    }
+    if(slot < 0)
+    {
+        slot = 0;
+        for(unsigned int s = 1; s < slotCount; ++s)
+        {
+            if(slots[s].lastUse < slots[slot].lastUse)
+                slot = s;
+        }
+        ++evictions;
+    }
+
+    // Invalidated on disk before it is rewritten and only marked valid again once the new view is on
+    // disk too, so a crash or power cut part way through leaves no half written view behind
+    Slot& entry = slots[slot];
+    entry.valid = 0;
+    if(!Sync(&entry, sizeof(entry)))
+        return;
+    UBYTE* data = SlotData(slot);
+    memcpy(data, image, imageBytes);
+    entry.hasIterations = iterationBytes > 0 && iterations != NULL;
+    if(entry.hasIterations)
+    {
+        memcpy(data + imageBytes, iterations, iterationBytes);
+    }
+    entry.level = key.level;
+    entry.path = key.path;
+    entry.params = key.params;
+    entry.budgetScale = budgetScale;
+    entry.lastUse = ++header->clock;
+    if(!Sync(data, slotBytes) || !Sync(&entry, sizeof(entry)))
+        return;
+    entry.valid = 1;
+    Sync(&entry, sizeof(entry));
+}
@@ -0,0 +1,82 @@
+#ifndef TILECACHE_HPP
+#define TILECACHE_HPP
+
+#include "DEV_Config.h"
+#include <cstddef>
+#include <cstdint>
+
+// Rendered views kept in a memory mapped file across runs. Every zoom is an exact quadrant of the
+// view before it, so a view is a quadtree node addressed by its level and the two bits per level of
+// the quadrants taken from the root. The file holds a fixed number of slots for one image size;
+// when they are all taken the least recently used one is overwritten.
+class TileCache
+{
+public:
+    // Levels deeper than this aren't cached, they hardly ever come round twice anyway
+    static constexpr unsigned int MaxLevel = 31;
+
+    struct Key
+    {
+        uint32_t level;
+        uint64_t path;
+        // Everything else the pixels depend on: resolution, iteration budget, render mode
+        uint64_t params;
+    };
+
+    // Opens or creates the file, starting it over if it was made for a different image size.
+    // If that fails the cache stays closed and every lookup misses.
+    TileCache(const char* path, size_t maxBytes, UWORD width, UWORD height, bool storeIterations);
+    ~TileCache();
+    bool IsOpen() { return header != NULL; };
+
+    // Copies a cached view into image and, when the slot has them and iterations isn't NULL, its
+    // per pixel escape counts. budgetScale receives the adaptive budget scale left after the view was rendered.
+    bool Lookup(const Key& key, UBYTE* image, uint16_t* iterations, double& budgetScale, bool& hasIterations);
+    void Store(const Key& key, const UBYTE* image, const uint16_t* iterations, double budgetScale);
+
+    unsigned long long GetHits() { return hits; };
+    unsigned long long GetMisses() { return misses; };
+    unsigned long long GetEvictions() { return evictions; };
+    unsigned int GetSlotCount() { return slotCount; };
+
+private:
+    struct FileHeader
+    {
+        char magic[8];
+        uint32_t width;
+        uint32_t height;
+        uint32_t slotCount;
+        uint32_t storeIterations;
+        // Bumped on every lookup hit and store, slots remember when they were last used
+        uint64_t clock;
+    };
+    struct Slot
+    {
+        uint32_t valid;
+        uint32_t level;
+        uint64_t path;
+        uint64_t params;
+        uint64_t lastUse;
+        double budgetScale;
+        uint32_t hasIterations;
+        uint32_t reserved;
+    };
+
+    int FindSlot(const Key& key);
+    UBYTE* SlotData(unsigned int slot);
+    bool Sync(const void* start, size_t length);
+
+    int fd;
+    size_t mappedSize;
+    FileHeader* header;
+    Slot* slots;
+    unsigned int slotCount;
+    size_t imageBytes;
+    size_t iterationBytes;
+    size_t slotBytes;
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long evictions;
+};
+
+#endif
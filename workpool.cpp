@@ -0,0 +1,157 @@
+#include "workpool.hpp"
+#include <algorithm>
+
+using namespace std;
+
+WorkStealingPool::WorkStealingPool(unsigned int threadCount)
+{
+    this->threadCount = threadCount > 0 ? threadCount : DefaultThreadCount();
+    current = nullptr;
+    generation = 0;
+    busyWorkers = 0;
+    stopping = false;
+
+    for(unsigned int i = 0; i < this->threadCount; ++i)
+    {
+        ranges.emplace_back(new Range());
+    }
+
+    // Worker 0 is whichever thread calls Run
+    for(unsigned int i = 1; i < this->threadCount; ++i)
+    {
+        threads.emplace_back(&WorkStealingPool::WorkerLoop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        lock_guard<mutex> guard(stateLock);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for(auto& worker : threads)
+    {
+        worker.join();
+    }
+}
+
+unsigned int WorkStealingPool::DefaultThreadCount()
+{
+    auto cores = thread::hardware_concurrency();
+    return cores > 0 ? cores : 1;
+}
+
+void WorkStealingPool::Run(unsigned int taskCount, const function<void(unsigned int, unsigned int)>& task)
+{
+    if(taskCount == 0)
+        return;
+
+    if(threadCount == 1)
+    {
+        for(unsigned int i = 0; i < taskCount; ++i)
+        {
+            task(0, i);
+        }
+        return;
+    }
+
+    unsigned int chunk = (taskCount + threadCount - 1) / threadCount;
+    for(unsigned int i = 0; i < threadCount; ++i)
+    {
+        lock_guard<mutex> guard(ranges[i]->lock);
+        ranges[i]->begin = min(taskCount, i * chunk);
+        ranges[i]->end = min(taskCount, (i + 1) * chunk);
+    }
+
+    {
+        lock_guard<mutex> guard(stateLock);
+        current = &task;
+        busyWorkers = threadCount - 1;
+        ++generation;
+    }
+    wake.notify_all();
+
+    Drain(0);
+
+    unique_lock<mutex> guard(stateLock);
+    finished.wait(guard, [this] { return busyWorkers == 0; });
+    current = nullptr;
+}
+
+void WorkStealingPool::WorkerLoop(unsigned int self)
+{
+    unsigned long long seen = 0;
+    while(true)
+    {
+        {
+            unique_lock<mutex> guard(stateLock);
+            wake.wait(guard, [this, seen] { return stopping || generation != seen; });
+            if(stopping)
+                return;
+            seen = generation;
+        }
+
+        Drain(self);
+
+        lock_guard<mutex> guard(stateLock);
+        if(--busyWorkers == 0)
+        {
+            finished.notify_all();
+        }
+    }
+}
+
+void WorkStealingPool::Drain(unsigned int self)
+{
+    unsigned int task;
+    while(TakeOwn(self, task) || Steal(self, task))
+    {
+        (*current)(self, task);
+    }
+}
+
+bool WorkStealingPool::TakeOwn(unsigned int self, unsigned int& task)
+{
+    auto& range = *ranges[self];
+    lock_guard<mutex> guard(range.lock);
+    if(range.begin >= range.end)
+        return false;
+
+    task = range.begin++;
+    return true;
+}
+
+bool WorkStealingPool::Steal(unsigned int self, unsigned int& task)
+{
+    // Rob whichever worker has the most left, so heavy regions get shared out first
+    while(true)
+    {
+        unsigned int victim = self;
+        unsigned int mostLeft = 0;
+        for(unsigned int i = 0; i < threadCount; ++i)
+        {
+            if(i == self)
+                continue;
+
+            lock_guard<mutex> guard(ranges[i]->lock);
+            unsigned int left = ranges[i]->end - ranges[i]->begin;
+            if(left > mostLeft)
+            {
+                mostLeft = left;
+                victim = i;
+            }
+        }
+
+        if(victim == self)
+            return false;
+
+        lock_guard<mutex> guard(ranges[victim]->lock);
+        if(ranges[victim]->begin < ranges[victim]->end)
+        {
+            task = --ranges[victim]->end;
+            return true;
+        }
+    }
+}
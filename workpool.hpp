@@ -0,0 +1,55 @@
+#ifndef WORKPOOL_HPP
+#define WORKPOOL_HPP
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that run batches of indexed tasks.
+// Each batch is split into one contiguous range per worker; a worker takes
+// tasks from the front of its own range and, once that is empty, steals
+// from the back of the busiest other range. The calling thread acts as
+// worker 0, so a pool of one thread runs everything inline.
+class WorkStealingPool
+{
+public:
+    explicit WorkStealingPool(unsigned int threadCount = 0);
+    ~WorkStealingPool();
+
+    unsigned int GetThreadCount() const { return threadCount; };
+
+    // Runs task(worker, index) for every index in [0, taskCount) and returns once all are done
+    void Run(unsigned int taskCount, const std::function<void(unsigned int, unsigned int)>& task);
+
+    static unsigned int DefaultThreadCount();
+
+private:
+    struct Range
+    {
+        std::mutex lock;
+        unsigned int begin = 0;
+        unsigned int end = 0;
+    };
+
+    void WorkerLoop(unsigned int self);
+    void Drain(unsigned int self);
+    bool TakeOwn(unsigned int self, unsigned int& task);
+    bool Steal(unsigned int self, unsigned int& task);
+
+    unsigned int threadCount;
+    std::vector<std::unique_ptr<Range>> ranges;
+    std::vector<std::thread> threads;
+
+    std::mutex stateLock;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    const std::function<void(unsigned int, unsigned int)>* current;
+    unsigned long long generation;
+    unsigned int busyWorkers;
+    bool stopping;
+};
+
+#endif